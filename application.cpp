@@ -1,15 +1,41 @@
 #include "application.h"
+#include "event_log.h"
 #include "utility.h"
 
+#include <fstream>
+
 namespace DSVisualization {
     Application::Application()
-        : model_(), view_(), controller_(model_) {
+        : model_(), pipeline_(), view_(), controller_(model_) {
         PRINT_WHERE_AM_I();
+        // The model thread doesn't touch the model before the first query, which comes after
+        // the subscriptions
+        model_.SubscribeToEvents(pipeline_.GetObserver());
+        view_.SubscribeToEvents(&pipeline_);
         view_.SubscribeToQuery(controller_.GetObserver());
-        model_.SubscribeToData(view_.GetObserver());
+    }
+
+    Application::Application(const char* event_log_path)
+        : model_(), pipeline_(), view_(), controller_(model_) {
+        PRINT_WHERE_AM_I();
+        view_.SubscribeToEvents(&pipeline_);
+        view_.DisableQueries();
+        // The player is the only producer of the pipeline
+        event_log_player_ = std::thread([this, path = std::string(event_log_path)]() {
+            std::ifstream event_log(path);
+            RedBlackTree<int>::Event event;
+            while (!pipeline_.IsClosed() && ReadEvent(event_log, &event)) {
+                pipeline_.Publish(event);
+            }
+        });
     }
 
     Application::~Application() {
         PRINT_WHERE_AM_I();
+        // The model thread must not wait for a view which is going away
+        pipeline_.Close();
+        if (event_log_player_.joinable()) {
+            event_log_player_.join();
+        }
     }
 }// namespace DSVisualization
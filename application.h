@@ -1,10 +1,12 @@
 #pragma once
 
 #include "controller.h"
+#include "event_pipeline.h"
 #include "red_black_tree.h"
 #include "view.h"
 
 #include <iostream>
+#include <thread>
 
 #include <QApplication>
 
@@ -12,6 +14,9 @@ namespace DSVisualization {
     class Application {
     public:
         Application();
+        // Plays the events written by data_structure_visualization_cli --events instead of
+        // running the model, the queries are disabled
+        explicit Application(const char* event_log_path);
         Application(const Application&) = delete;
         Application& operator=(const Application&) = delete;
         Application(Application&&) = delete;
@@ -20,7 +25,9 @@ namespace DSVisualization {
 
     private:
         RedBlackTree<int> model_;
+        EventPipeline<RedBlackTree<int>::Event> pipeline_;
         View view_;
         Controller controller_;
+        std::thread event_log_player_;
     };
 }// namespace DSVisualization
@@ -0,0 +1,243 @@
+#include "event_log.h"
+#include "queries.h"
+#include "red_black_tree.h"
+
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Runs a script of queries against the tree without the GUI:
+//   data_structure_visualization_cli [--compact] [--events FILE] [--frame-rate N] [SCRIPT]
+// The script, a file or stdin, has one query a line: insert X, erase X or find X. Empty lines
+// and lines starting with # are skipped. The throughput goes to stderr and the final tree to
+// stdout, as a picture or with --compact as its values in order. With --events all the events
+// of the run are written to FILE, which the GUI plays when it is given the file.
+namespace {
+    using DSVisualization::TreeQuery;
+    using DSVisualization::TreeQueryType;
+
+    constexpr size_t chunk_size = 1 << 20;
+
+    struct Options {
+        bool compact = false;
+        const char* events_path = nullptr;
+        size_t frame_rate = 0;
+        const char* script_path = nullptr;
+    };
+
+    bool ParseOptions(int argc, char* argv[], Options* options) {
+        for (int i = 1; i < argc; ++i) {
+            std::string_view arg = argv[i];
+            if (arg == "--compact") {
+                options->compact = true;
+            } else if (arg == "--events" && i + 1 < argc) {
+                options->events_path = argv[++i];
+            } else if (arg == "--frame-rate" && i + 1 < argc) {
+                std::string_view rate = argv[++i];
+                auto [end, error] =
+                        std::from_chars(rate.data(), rate.data() + rate.size(), options->frame_rate);
+                if (error != std::errc() || end != rate.data() + rate.size()) {
+                    return false;
+                }
+            } else if (!arg.starts_with("--") && !options->script_path) {
+                options->script_path = argv[i];
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Splits the script into batches of queries, reading it in big chunks
+    class ScriptReader {
+    public:
+        explicit ScriptReader(std::FILE* file) : file_(file), buffer_(chunk_size) {
+        }
+
+        // Returns false at the end of the script or on an error, see Error()
+        bool ReadBatch(std::vector<TreeQuery>* batch) {
+            batch->clear();
+            while (batch->empty()) {
+                size_t read = std::fread(buffer_.data() + tail_.size(), 1,
+                                         buffer_.size() - tail_.size(), file_);
+                // A short read is the end of the script only if it was not an error
+                if (std::ferror(file_)) {
+                    error_ = "line " + std::to_string(line_number_ + 1) + ": read error";
+                    return false;
+                }
+                std::memcpy(buffer_.data(), tail_.data(), tail_.size());
+                size_t size = tail_.size() + read;
+                bool at_end = read == 0;
+                std::string_view text(buffer_.data(), size);
+                size_t line_start = 0;
+                while (line_start < text.size()) {
+                    size_t line_end = text.find('\n', line_start);
+                    if (line_end == std::string_view::npos) {
+                        if (!at_end) {
+                            break;
+                        }
+                        line_end = text.size();
+                    }
+                    if (!ParseLine(text.substr(line_start, line_end - line_start), batch)) {
+                        return false;
+                    }
+                    line_start = line_end + 1;
+                }
+                tail_.assign(line_start < text.size() ? text.substr(line_start) : "");
+                if (at_end) {
+                    return !batch->empty();
+                }
+                if (tail_.size() == buffer_.size()) {
+                    error_ = "line " + std::to_string(line_number_ + 1) + ": too long";
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        [[nodiscard]] const std::string& Error() const {
+            return error_;
+        }
+
+    private:
+        bool ParseLine(std::string_view line, std::vector<TreeQuery>* batch) {
+            ++line_number_;
+            auto is_space = [](char c) {
+                return c == ' ' || c == '\t' || c == '\r';
+            };
+            size_t begin = 0;
+            while (begin < line.size() && is_space(line[begin])) {
+                ++begin;
+            }
+            size_t end = line.size();
+            while (end > begin && is_space(line[end - 1])) {
+                --end;
+            }
+            line = line.substr(begin, end - begin);
+            if (line.empty() || line[0] == '#') {
+                return true;
+            }
+            size_t space = line.find_first_of(" \t");
+            std::string_view command = line.substr(0, space);
+            TreeQuery query;
+            if (command == "insert") {
+                query.query_type = TreeQueryType::insert;
+            } else if (command == "erase") {
+                query.query_type = TreeQueryType::erase;
+            } else if (command == "find") {
+                query.query_type = TreeQueryType::find;
+            } else {
+                error_ = "line " + std::to_string(line_number_) + ": unknown command '" +
+                         std::string(command) + "'";
+                return false;
+            }
+            std::string_view value =
+                    space == std::string_view::npos ? "" : line.substr(space + 1);
+            while (!value.empty() && is_space(value[0])) {
+                value.remove_prefix(1);
+            }
+            auto [value_end, error] =
+                    std::from_chars(value.data(), value.data() + value.size(), query.value);
+            if (value.empty() || error != std::errc() || value_end != value.data() + value.size()) {
+                error_ = "line " + std::to_string(line_number_) + ": bad value '" +
+                         std::string(value) + "'";
+                return false;
+            }
+            batch->push_back(query);
+            return true;
+        }
+
+        std::FILE* file_;
+        std::vector<char> buffer_;
+        // The unfinished last line of the previous chunk
+        std::string tail_;
+        size_t line_number_ = 0;
+        std::string error_;
+    };
+
+    template<typename Tree>
+    int Run(ScriptReader& reader, Tree& tree, const Options& options) {
+        using Clock = std::chrono::steady_clock;
+        std::vector<TreeQuery> batch;
+        size_t queries_count = 0;
+        Clock::duration run_time{};
+        while (reader.ReadBatch(&batch)) {
+            auto start = Clock::now();
+            for (const TreeQuery& query : batch) {
+                switch (query.query_type) {
+                    case TreeQueryType::insert:
+                        tree.Insert(query.value);
+                        break;
+                    case TreeQueryType::erase:
+                        tree.Erase(query.value);
+                        break;
+                    default:
+                        tree.Find(query.value);
+                        break;
+                }
+            }
+            run_time += Clock::now() - start;
+            queries_count += batch.size();
+        }
+        if (!reader.Error().empty()) {
+            std::cerr << reader.Error() << "\n";
+            return 1;
+        }
+        double seconds = std::chrono::duration<double>(run_time).count();
+        std::cerr << queries_count << " queries in " << seconds << " s, "
+                  << (seconds > 0 ? static_cast<double>(queries_count) / seconds : 0)
+                  << " queries/s, " << tree.Size() << " values\n";
+        if (options.compact) {
+            for (int value : tree) {
+                std::cout << value << ' ';
+            }
+            std::cout << '\n';
+        } else {
+            std::cout << tree;
+        }
+        return 0;
+    }
+}// namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!ParseOptions(argc, argv, &options)) {
+        std::cerr << "usage: " << argv[0]
+                  << " [--compact] [--events FILE] [--frame-rate N] [SCRIPT]\n";
+        return 2;
+    }
+    std::FILE* script = options.script_path ? std::fopen(options.script_path, "rb") : stdin;
+    if (!script) {
+        std::cerr << "cannot open " << options.script_path << "\n";
+        return 1;
+    }
+    ScriptReader reader(script);
+    int result = 0;
+    if (options.events_path) {
+        std::ofstream events(options.events_path);
+        if (!events) {
+            std::cerr << "cannot open " << options.events_path << "\n";
+            return 1;
+        }
+        DSVisualization::RedBlackTree<int> tree;
+        DSVisualization::EventLogWriter<DSVisualization::RedBlackTree<int>::Event> writer(events);
+        tree.SetFrameRate(options.frame_rate);
+        tree.SubscribeToEvents(writer.GetObserver());
+        result = Run(reader, tree, options);
+        // The log ends with the final tree, not with the empty one sent by the destructor
+        writer.GetObserver()->Unsubscribe();
+    } else {
+        DSVisualization::RedBlackTree<int, DSVisualization::NoTracing> tree;
+        result = Run(reader, tree, options);
+    }
+    if (script != stdin) {
+        std::fclose(script);
+    }
+    return result;
+}
@@ -0,0 +1,424 @@
+#pragma once
+
+#include "red_black_tree.h"
+
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+#ifdef INVARIANTS_CHECK
+#include <algorithm>
+#endif
+
+namespace DSVisualization {
+    // Red-black tree with the same interface as an untraced RedBlackTree, but with all the nodes
+    // stored in one vector. Links are 32-bit indices into it, index 0 stands for NIL and the
+    // color is kept in the top bit of the parent link, so a node of int takes 16 bytes instead
+    // of the 40 of RedBlackTreeNode<int>, which also keeps its subtree size. Erase moves the last
+    // node into the freed slot to keep the vector dense, therefore it invalidates iterators.
+    template<typename T>
+    class CompactRedBlackTree {
+    public:
+        using Index = uint32_t;
+
+        struct Node {
+            [[nodiscard]] Index Parent() const {
+                return parent_and_color & parent_mask;
+            }
+
+            [[nodiscard]] Color GetColor() const {
+                return (parent_and_color & red_bit) ? Color::red : Color::black;
+            }
+
+            void SetParent(Index parent) {
+                parent_and_color = (parent_and_color & red_bit) | parent;
+            }
+
+            void SetColor(Color color) {
+                parent_and_color = (parent_and_color & parent_mask) |
+                                   (color == Color::red ? red_bit : 0);
+            }
+
+            Index parent_and_color;
+            Index kids[2];
+            T value;
+        };
+
+        CompactRedBlackTree() : nodes_(1) {
+        }
+
+        bool Insert(const T& value) {
+            Index parent = nil;
+            Index node = root_;
+            while (node != nil) {
+                parent = node;
+                if (value < nodes_[node].value) {
+                    node = Left(node);
+                } else if (value == nodes_[node].value) {
+                    return false;
+                } else {
+                    node = Right(node);
+                }
+            }
+            assert(nodes_.size() <= parent_mask);
+            node = static_cast<Index>(nodes_.size());
+            nodes_.push_back(Node{parent | red_bit, {nil, nil}, value});
+            if (parent == nil) {
+                root_ = node;
+            } else {
+                nodes_[parent].kids[value < nodes_[parent].value ? left : right] = node;
+            }
+            InsertFixup(node);
+            return true;
+        }
+
+        bool Erase(const T& value) {
+            Index node = SearchNearValue(value);
+            if (node == nil || !(nodes_[node].value == value)) {
+                return false;
+            }
+            Color erased_color = GetColor(node);
+            Index child = nil;
+            Index child_parent = nil;
+            if (Left(node) == nil || Right(node) == nil) {
+                child = (Left(node) == nil ? Right(node) : Left(node));
+                child_parent = Parent(node);
+                Transplant(node, child);
+            } else {
+                Index next = Right(node);
+                while (Left(next) != nil) {
+                    next = Left(next);
+                }
+                erased_color = GetColor(next);
+                child = Right(next);
+                if (Parent(next) == node) {
+                    child_parent = next;
+                } else {
+                    child_parent = Parent(next);
+                    Transplant(next, child);
+                    SetKid(next, right, Right(node));
+                }
+                Transplant(node, next);
+                SetKid(next, left, Left(node));
+                nodes_[next].SetColor(GetColor(node));
+            }
+            if (erased_color == Color::black) {
+                EraseFixup(child, child_parent);
+            }
+            RemoveSlot(node);
+            return true;
+        }
+
+        bool Find(const T& value) const {
+            Index node = SearchNearValue(value);
+            return node != nil && nodes_[node].value == value;
+        }
+
+        [[nodiscard]] size_t Size() const {
+            return nodes_.size() - 1;
+        }
+
+        [[nodiscard]] bool Empty() const {
+            return root_ == nil;
+        }
+
+        void Clear() {
+            nodes_.resize(1);
+            root_ = nil;
+        }
+
+        void Reserve(size_t size) {
+            nodes_.reserve(size + 1);
+        }
+
+#ifdef INVARIANTS_CHECK
+        [[nodiscard]] bool CheckInvariants() const {
+            if (GetColor(root_) == Color::red) {
+                return false;
+            }
+            std::vector<T> values;
+            std::vector<int32_t> depths;
+            if (!CheckInvariants(root_, nil, &values, &depths, 0)) {
+                return false;
+            }
+            if (values.size() != Size() || !std::is_sorted(values.begin(), values.end())) {
+                return false;
+            }
+            return *std::max_element(depths.begin(), depths.end()) ==
+                   *std::min_element(depths.begin(), depths.end());
+        }
+#endif
+
+        class ConstIterator {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = T;
+
+            ConstIterator(const CompactRedBlackTree* tree, Index node) : tree_(tree), node_(node) {
+            }
+
+            ConstIterator& operator++() {
+                assert(node_ != nil);
+                node_ = tree_->NextNode(node_);
+                return *this;
+            }
+
+            ConstIterator operator++(int) {
+                ConstIterator result = *this;
+                ++*this;
+                return result;
+            }
+
+            bool operator!=(const ConstIterator& other) const {
+                return node_ != other.node_;
+            }
+
+            const T& operator*() const {
+                return tree_->nodes_[node_].value;
+            }
+
+            const T* operator->() const {
+                return &tree_->nodes_[node_].value;
+            }
+
+        private:
+            const CompactRedBlackTree* tree_;
+            Index node_;
+        };
+
+        ConstIterator begin() const {
+            Index node = root_;
+            while (node != nil && Left(node) != nil) {
+                node = Left(node);
+            }
+            return ConstIterator(this, node);
+        }
+
+        ConstIterator end() const {
+            return ConstIterator(this, nil);
+        }
+
+        friend std::ostream& operator<<(std::ostream& os, const CompactRedBlackTree& t) {
+            if (t.root_ == nil) {
+                return os << "Empty\n";
+            }
+            t.Print(os, t.root_, 0);
+            return os;
+        }
+
+    private:
+        static constexpr Index nil = 0;
+        static constexpr Index red_bit = Index(1) << 31;
+        static constexpr Index parent_mask = red_bit - 1;
+        static constexpr int left = 0;
+        static constexpr int right = 1;
+
+        [[nodiscard]] Index Parent(Index node) const {
+            return nodes_[node].Parent();
+        }
+
+        [[nodiscard]] Index Left(Index node) const {
+            return nodes_[node].kids[left];
+        }
+
+        [[nodiscard]] Index Right(Index node) const {
+            return nodes_[node].kids[right];
+        }
+
+        // NIL is black, the same as for RedBlackTree
+        [[nodiscard]] Color GetColor(Index node) const {
+            return node == nil ? Color::black : nodes_[node].GetColor();
+        }
+
+        [[nodiscard]] int WhichKid(Index parent, Index kid) const {
+            return nodes_[parent].kids[left] == kid ? left : right;
+        }
+
+        void SetKid(Index parent, int direction, Index kid) {
+            nodes_[parent].kids[direction] = kid;
+            if (kid != nil) {
+                nodes_[kid].SetParent(parent);
+            }
+        }
+
+        // Puts new_node in the place of node in the parent of node
+        void Transplant(Index node, Index new_node) {
+            Index parent = Parent(node);
+            if (parent == nil) {
+                root_ = new_node;
+                if (new_node != nil) {
+                    nodes_[new_node].SetParent(nil);
+                }
+            } else {
+                SetKid(parent, WhichKid(parent, node), new_node);
+            }
+        }
+
+        // Moves node down in the given direction, its opposite kid takes its place
+        void Rotate(Index node, int direction) {
+            Index kid = nodes_[node].kids[1 - direction];
+            SetKid(node, 1 - direction, nodes_[kid].kids[direction]);
+            Transplant(node, kid);
+            SetKid(kid, direction, node);
+        }
+
+        void InsertFixup(Index node) {
+            while (GetColor(Parent(node)) == Color::red) {
+                Index parent = Parent(node);
+                Index grandparent = Parent(parent);
+                int side = WhichKid(grandparent, parent);
+                Index uncle = nodes_[grandparent].kids[1 - side];
+                if (GetColor(uncle) == Color::red) {
+                    nodes_[parent].SetColor(Color::black);
+                    nodes_[uncle].SetColor(Color::black);
+                    nodes_[grandparent].SetColor(Color::red);
+                    node = grandparent;
+                    continue;
+                }
+                if (WhichKid(parent, node) != side) {
+                    Rotate(parent, side);
+                    node = parent;
+                    parent = Parent(node);
+                }
+                nodes_[parent].SetColor(Color::black);
+                nodes_[grandparent].SetColor(Color::red);
+                Rotate(grandparent, 1 - side);
+            }
+            nodes_[root_].SetColor(Color::black);
+        }
+
+        void EraseFixup(Index node, Index parent) {
+            while (node != root_ && GetColor(node) == Color::black) {
+                int side = (Left(parent) == node ? left : right);
+                Index sibling = nodes_[parent].kids[1 - side];
+                if (GetColor(sibling) == Color::red) {
+                    nodes_[sibling].SetColor(Color::black);
+                    nodes_[parent].SetColor(Color::red);
+                    Rotate(parent, side);
+                    sibling = nodes_[parent].kids[1 - side];
+                }
+                if (GetColor(Left(sibling)) == Color::black &&
+                    GetColor(Right(sibling)) == Color::black) {
+                    nodes_[sibling].SetColor(Color::red);
+                    node = parent;
+                    parent = Parent(node);
+                    continue;
+                }
+                if (GetColor(nodes_[sibling].kids[1 - side]) == Color::black) {
+                    nodes_[nodes_[sibling].kids[side]].SetColor(Color::black);
+                    nodes_[sibling].SetColor(Color::red);
+                    Rotate(sibling, 1 - side);
+                    sibling = nodes_[parent].kids[1 - side];
+                }
+                nodes_[sibling].SetColor(GetColor(parent));
+                nodes_[parent].SetColor(Color::black);
+                nodes_[nodes_[sibling].kids[1 - side]].SetColor(Color::black);
+                Rotate(parent, side);
+                node = root_;
+            }
+            if (node != nil) {
+                nodes_[node].SetColor(Color::black);
+            }
+        }
+
+        // The erased node is already unlinked: the last node of the vector is moved into its slot
+        void RemoveSlot(Index node) {
+            Index last = static_cast<Index>(nodes_.size() - 1);
+            if (node != last) {
+                nodes_[node] = std::move(nodes_[last]);
+                Index parent = Parent(node);
+                if (parent == nil) {
+                    root_ = node;
+                } else {
+                    nodes_[parent].kids[WhichKid(parent, last)] = node;
+                }
+                for (Index kid : nodes_[node].kids) {
+                    if (kid != nil) {
+                        nodes_[kid].SetParent(node);
+                    }
+                }
+            }
+            nodes_.pop_back();
+        }
+
+        [[nodiscard]] Index SearchNearValue(const T& value) const {
+            Index node = root_;
+            while (node != nil) {
+                if (value < nodes_[node].value) {
+                    if (Left(node) == nil) {
+                        break;
+                    }
+                    node = Left(node);
+                } else if (value == nodes_[node].value) {
+                    break;
+                } else {
+                    if (Right(node) == nil) {
+                        break;
+                    }
+                    node = Right(node);
+                }
+            }
+            return node;
+        }
+
+        [[nodiscard]] Index NextNode(Index node) const {
+            if (Right(node) != nil) {
+                node = Right(node);
+                while (Left(node) != nil) {
+                    node = Left(node);
+                }
+                return node;
+            }
+            while (Parent(node) != nil && Right(Parent(node)) == node) {
+                node = Parent(node);
+            }
+            return Parent(node);
+        }
+
+        void Print(std::ostream& os, Index node, int32_t depth) const {
+            for (int32_t i = 1; i < depth; ++i) {
+                os << "|   ";
+            }
+            if (depth > 0) {
+                os << "|---";
+            }
+            if (node == nil) {
+                os << "(NIL, b)\n";
+                return;
+            }
+            os << "(" << nodes_[node].value << ", "
+               << (GetColor(node) == Color::red ? 'r' : 'b') << ")\n";
+            Print(os, Left(node), depth + 1);
+            Print(os, Right(node), depth + 1);
+        }
+
+#ifdef INVARIANTS_CHECK
+        bool CheckInvariants(Index node, Index parent, std::vector<T>* values,
+                             std::vector<int32_t>* depths, int32_t black_depth) const {
+            if (node == nil) {
+                depths->push_back(black_depth + 1);
+                return true;
+            }
+            if (Parent(node) != parent) {
+                return false;
+            }
+            if (GetColor(node) == Color::black) {
+                ++black_depth;
+            } else if (GetColor(Left(node)) == Color::red || GetColor(Right(node)) == Color::red) {
+                return false;
+            }
+            if (!CheckInvariants(Left(node), node, values, depths, black_depth)) {
+                return false;
+            }
+            values->push_back(nodes_[node].value);
+            return CheckInvariants(Right(node), node, values, depths, black_depth);
+        }
+#endif
+
+        // nodes_[0] is a placeholder, so that index 0 can be used as NIL
+        std::vector<Node> nodes_;
+        Index root_ = nil;
+    };
+}// namespace DSVisualization
@@ -1,21 +1,37 @@
 #include "controller.h"
+#include "history.h"
 #include "observer.h"
 #include "queries.h"
 #include "red_black_tree.h"
 #include "utility.h"
 
+#include <algorithm>
+
 namespace DSVisualization {
     Controller::Controller(Model& model)
+        : Controller(model, History::default_max_checkpoints) {
+    }
+
+    Controller::Controller(Model& model, size_t max_checkpoints)
         : observer_view_controller_(
                   [this](const TreeQuery& x) {
                       OnNotifyFromView(x);
                   }),
-          model_ptr_(&model) {
+          model_ptr_(&model), history_(std::make_unique<History>(max_checkpoints)),
+          model_thread_([this]() {
+              RunModel();
+          }) {
         PRINT_WHERE_AM_I();
     }
 
     Controller::~Controller() {
         PRINT_WHERE_AM_I();
+        {
+            std::lock_guard lock(mutex_);
+            stopping_ = true;
+        }
+        queries_changed_.notify_all();
+        model_thread_.join();
     }
 
     Observer<TreeQuery>* Controller::GetObserver() {
@@ -23,20 +39,94 @@ namespace DSVisualization {
         return &observer_view_controller_;
     }
 
+    void Controller::WaitUntilIdle() {
+        std::unique_lock lock(mutex_);
+        queries_changed_.wait(lock, [this]() {
+            return queries_.empty() && !busy_;
+        });
+    }
+
+    const History& Controller::GetHistory() const {
+        return *history_;
+    }
+
+    Controller::QueueStats Controller::GetQueueStats() const {
+        std::lock_guard lock(mutex_);
+        QueueStats stats = stats_;
+        stats.depth = queries_.size();
+        return stats;
+    }
+
     void Controller::OnNotifyFromView(const TreeQuery& query) {
         PRINT_WHERE_AM_I();
+        Enqueue(query);
+    }
+
+    void Controller::Enqueue(const TreeQuery& query, Callback on_completion) {
+        {
+            std::lock_guard lock(mutex_);
+            queries_.push_back(PendingQuery{query, std::move(on_completion), Clock::now()});
+        }
+        queries_changed_.notify_all();
+    }
+
+    // The queries left when the controller is destroyed are dropped
+    void Controller::RunModel() {
+        std::unique_lock lock(mutex_);
+        while (true) {
+            queries_changed_.wait(lock, [this]() {
+                return stopping_ || !queries_.empty();
+            });
+            if (stopping_) {
+                return;
+            }
+            PendingQuery pending = std::move(queries_.front());
+            queries_.pop_front();
+            busy_ = true;
+            Clock::time_point start = Clock::now();
+            QueryResult result{pending.query, true, start - pending.enqueue_time, {}};
+            ++stats_.handled;
+            stats_.last_wait_time = result.wait_time;
+            stats_.max_wait_time = std::max(stats_.max_wait_time, result.wait_time);
+            stats_.total_wait_time += result.wait_time;
+            lock.unlock();
+            result.success = HandleQuery(pending.query);
+            result.run_time = Clock::now() - start;
+            if (pending.on_completion) {
+                pending.on_completion(result);
+            }
+            lock.lock();
+            busy_ = false;
+            queries_changed_.notify_all();
+        }
+    }
+
+    bool Controller::HandleQuery(const TreeQuery& query) {
+        PRINT_WHERE_AM_I();
+        bool success = true;
         switch (query.query_type) {
             case TreeQueryType::insert:
-                model_ptr_->Insert(query.value);
+                success = model_ptr_->Insert(query.value);
+                history_->Record(query);
                 break;
             case TreeQueryType::erase:
-                model_ptr_->Erase(query.value);
+                success = model_ptr_->Erase(query.value);
+                history_->Record(query);
                 break;
             case TreeQueryType::find:
-                model_ptr_->Find(query.value);
+                success = model_ptr_->Find(query.value);
+                break;
+            case TreeQueryType::go_to_step:
+                success = query.value >= 0;
+                if (success) {
+                    history_->GoToStep(std::min(static_cast<size_t>(query.value),
+                                                history_->StepCount()),
+                                       *model_ptr_);
+                }
                 break;
             default:
                 break;
         }
+        return success;
     }
 }// namespace DSVisualization
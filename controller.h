@@ -2,22 +2,60 @@
 
 #include "observable.h"
 #include "observer.h"
+#include "queries.h"
 
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 
 namespace DSVisualization {
-    template<typename T>
+    struct Tracing;
+    struct NoAugmentation;
+
+    template<typename T, typename TracingPolicy, typename Allocator, typename Augmentation,
+             typename Compare>
     class RedBlackTree;
 
-    struct TreeQuery;
+    class History;
 
+    // Runs the model on its own thread: the queries from the view are queued and handled there
+    // one by one in order, so the view never waits for the model
     class Controller {
-        using Model = RedBlackTree<int>;
+        using Model =
+                RedBlackTree<int, Tracing, std::allocator<int>, NoAugmentation, std::less<int>>;
 
     public:
+        using Clock = std::chrono::steady_clock;
+
+        struct QueryResult {
+            TreeQuery query;
+            // What Insert, Erase or Find returned, true for other queries
+            bool success = true;
+            // Time in the queue and time of handling
+            Clock::duration wait_time{};
+            Clock::duration run_time{};
+        };
+
+        // Called on the model thread when its query is handled
+        using Callback = std::function<void(const QueryResult&)>;
+
+        struct QueueStats {
+            // Queries waiting, the one being handled is not counted
+            size_t depth = 0;
+            size_t handled = 0;
+            Clock::duration last_wait_time{};
+            Clock::duration max_wait_time{};
+            Clock::duration total_wait_time{};
+        };
+
         explicit Controller(Model& model);
+        Controller(Model& model, size_t max_checkpoints);
         Controller() = delete;
         Controller(const Controller&) = delete;
         Controller& operator=(const Controller&) = delete;
@@ -28,10 +66,38 @@ namespace DSVisualization {
 
         [[nodiscard]] Observer<TreeQuery>* GetObserver();
 
+        // Puts the query at the end of the queue, on_completion may be empty
+        void Enqueue(const TreeQuery& query, Callback on_completion = {});
+
+        // Blocks until all the queries sent so far are handled
+        void WaitUntilIdle();
+
+        [[nodiscard]] QueueStats GetQueueStats() const;
+
+        // Insert and erase queries handled so far, go_to_step queries move along it. Only
+        // valid while the controller is idle.
+        [[nodiscard]] const History& GetHistory() const;
+
     private:
         void OnNotifyFromView(const TreeQuery& value);
+        bool HandleQuery(const TreeQuery& query);
+        void RunModel();
+
+        struct PendingQuery {
+            TreeQuery query;
+            Callback on_completion;
+            Clock::time_point enqueue_time;
+        };
 
         Observer<TreeQuery> observer_view_controller_;
         Model* model_ptr_;
+        std::unique_ptr<History> history_;
+        mutable std::mutex mutex_;
+        std::condition_variable queries_changed_;
+        std::deque<PendingQuery> queries_;
+        QueueStats stats_;
+        bool busy_ = false;
+        bool stopping_ = false;
+        std::thread model_thread_;
     };
 }// namespace DSVisualization
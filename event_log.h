@@ -0,0 +1,76 @@
+#pragma once
+
+#include "observer.h"
+#include "red_black_tree.h"
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+
+namespace DSVisualization {
+    // Text form of the TreeEvents of a run, one event a line, to play the run in the GUI later:
+    //   type node other tree_size kid status color [value]
+    // with the enums as numbers. The nodes are written as the numbers of their addresses, which
+    // only tell the nodes apart, so a log can be read in another process.
+    template<typename Event>
+    void WriteEvent(std::ostream& os, const Event& event) {
+        os << static_cast<int>(event.type) << ' ' << reinterpret_cast<uintptr_t>(event.node) << ' '
+           << reinterpret_cast<uintptr_t>(event.other) << ' ' << event.tree_size << ' '
+           << static_cast<int>(event.kid) << ' ' << static_cast<int>(event.status) << ' '
+           << static_cast<int>(event.color);
+        if (event.value) {
+            os << ' ' << *event.value;
+        }
+        os << '\n';
+    }
+
+    // Returns false at the end of the log or on a malformed line
+    template<typename Event>
+    bool ReadEvent(std::istream& is, Event* event) {
+        int type = 0;
+        uintptr_t node = 0;
+        uintptr_t other = 0;
+        int kid = 0;
+        int status = 0;
+        int color = 0;
+        if (!(is >> type >> node >> other >> event->tree_size >> kid >> status >> color)) {
+            return false;
+        }
+        event->type = static_cast<TreeEventType>(type);
+        event->node = reinterpret_cast<const typename Event::Node*>(node);
+        event->other = reinterpret_cast<const typename Event::Node*>(other);
+        event->kid = static_cast<Kid>(kid);
+        event->status = static_cast<Status>(status);
+        event->color = static_cast<Color>(color);
+        event->value.reset();
+        while (is.peek() == ' ') {
+            is.get();
+        }
+        if (is.peek() != '\n' && is.peek() != std::istream::traits_type::eof()) {
+            typename Event::Value value;
+            if (!(is >> value)) {
+                return false;
+            }
+            event->value = std::move(value);
+        }
+        return true;
+    }
+
+    // Writes every event of the tree it is subscribed to
+    template<typename Event>
+    class EventLogWriter {
+    public:
+        explicit EventLogWriter(std::ostream& os)
+            : observer_([&os](const Event& event) {
+                  WriteEvent(os, event);
+              }) {
+        }
+
+        [[nodiscard]] Observer<Event>* GetObserver() {
+            return &observer_;
+        }
+
+    private:
+        Observer<Event> observer_;
+    };
+}// namespace DSVisualization
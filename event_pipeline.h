@@ -0,0 +1,166 @@
+#pragma once
+
+#include "observer.h"
+#include "red_black_tree.h"
+#include "spsc_queue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <optional>
+#include <thread>
+
+namespace DSVisualization {
+    enum class Backpressure { block, drop_frames, coalesce };
+
+    // Carries the TreeEvents of a model running on its own thread to a view on another one
+    // through an SpscQueue. The model publishes through GetObserver(), the view pops the events
+    // at its own pace. When the queue is full, the policy decides what happens:
+    //  - block: the model waits for a free slot, every frame is delivered;
+    //  - drop_frames: a step which doesn't fit is dropped, so the view skips that frame, other
+    //    events wait for a slot;
+    //  - coalesce: the model doesn't wait in the middle of an operation, the events which don't
+    //    fit are put aside with consecutive frames merged and flushed when the operation ends.
+    // With any policy the last frame of an operation and of a replaced tree is delivered.
+    template<typename Event>
+    class EventPipeline {
+    public:
+        static constexpr size_t default_capacity = 1 << 16;
+
+        explicit EventPipeline(size_t capacity = default_capacity,
+                               Backpressure backpressure = Backpressure::block)
+            : queue_(capacity), backpressure_(backpressure), observer_([this](const Event& event) {
+                  Publish(event);
+              }) {
+        }
+
+        EventPipeline(const EventPipeline&) = delete;
+        EventPipeline& operator=(const EventPipeline&) = delete;
+        EventPipeline(EventPipeline&&) = delete;
+        EventPipeline& operator=(EventPipeline&&) = delete;
+
+        // To be subscribed to the model, it is notified on the thread of the model
+        [[nodiscard]] Observer<Event>* GetObserver() {
+            return &observer_;
+        }
+
+        // Producer side
+        void Publish(const Event& event) {
+            if (event.type == TreeEventType::operation_started) {
+                ++depth_;
+            } else if (event.type == TreeEventType::operation_finished) {
+                --depth_;
+            }
+            switch (backpressure_) {
+                case Backpressure::block:
+                    PushOrWait(event);
+                    break;
+                case Backpressure::drop_frames:
+                    PublishDroppingFrames(event);
+                    break;
+                case Backpressure::coalesce:
+                    PublishCoalescing(event);
+                    break;
+            }
+        }
+
+        // Consumer side. Returns false if there are no events.
+        bool TryPop(Event* event) {
+            return queue_.TryPop(event);
+        }
+
+        // The producer doesn't wait for the consumer anymore, the events which don't fit are
+        // lost. Called when the view goes away.
+        void Close() {
+            closed_.store(true, std::memory_order_release);
+        }
+
+        [[nodiscard]] bool IsClosed() const {
+            return closed_.load(std::memory_order_acquire);
+        }
+
+        [[nodiscard]] size_t DroppedFrames() const {
+            return dropped_frames_.load(std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] size_t MergedFrames() const {
+            return merged_frames_.load(std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] size_t Capacity() const {
+            return queue_.Capacity();
+        }
+
+    private:
+        static constexpr int spins_before_sleep = 64;
+        static constexpr std::chrono::microseconds max_sleep{1000};
+
+        void PushOrWait(const Event& event) {
+            std::chrono::microseconds sleep{1};
+            for (int attempt = 0; !queue_.TryPush(event); ++attempt) {
+                if (closed_.load(std::memory_order_acquire)) {
+                    return;
+                }
+                if (attempt < spins_before_sleep) {
+                    std::this_thread::yield();
+                } else {
+                    std::this_thread::sleep_for(sleep);
+                    sleep = std::min(sleep * 2, max_sleep);
+                }
+            }
+        }
+
+        void PublishDroppingFrames(const Event& event) {
+            // The steps outside of operations end a replaced tree, they are never dropped
+            if (event.type == TreeEventType::step && depth_ > 0) {
+                if (queue_.TryPush(event)) {
+                    dropped_step_.reset();
+                } else {
+                    dropped_step_ = event;
+                    dropped_frames_.fetch_add(1, std::memory_order_relaxed);
+                }
+                return;
+            }
+            // The last step of an operation comes right before its end
+            if (event.type == TreeEventType::operation_finished && depth_ == 0 && dropped_step_) {
+                PushOrWait(*dropped_step_);
+                dropped_step_.reset();
+                dropped_frames_.fetch_sub(1, std::memory_order_relaxed);
+            }
+            PushOrWait(event);
+        }
+
+        void PublishCoalescing(const Event& event) {
+            if (overflow_.empty() && queue_.TryPush(event)) {
+                return;
+            }
+            if (!overflow_.empty() && overflow_.back().type == TreeEventType::step &&
+                event.type != TreeEventType::operation_finished) {
+                overflow_.pop_back();
+                merged_frames_.fetch_add(1, std::memory_order_relaxed);
+            }
+            overflow_.push_back(event);
+            while (!overflow_.empty() && queue_.TryPush(overflow_.front())) {
+                overflow_.pop_front();
+            }
+            if (depth_ == 0) {
+                for (; !overflow_.empty(); overflow_.pop_front()) {
+                    PushOrWait(overflow_.front());
+                }
+            }
+        }
+
+        SpscQueue<Event> queue_;
+        Backpressure backpressure_;
+        Observer<Event> observer_;
+        // The state of the producer
+        size_t depth_ = 0;
+        std::optional<Event> dropped_step_;
+        std::deque<Event> overflow_;
+        std::atomic<bool> closed_ = false;
+        std::atomic<size_t> dropped_frames_ = 0;
+        std::atomic<size_t> merged_frames_ = 0;
+    };
+}// namespace DSVisualization
@@ -0,0 +1,94 @@
+#include "history.h"
+#include "utility.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace DSVisualization {
+    History::History(size_t max_checkpoints, size_t checkpoint_interval)
+        : max_checkpoints_(max_checkpoints), checkpoint_interval_(checkpoint_interval) {
+        PRINT_WHERE_AM_I();
+        assert(max_checkpoints_ >= 2);
+        assert(checkpoint_interval_ > 0);
+        AddCheckpoint();
+    }
+
+    void History::Record(const TreeQuery& query) {
+        if (query.query_type != TreeQueryType::insert && query.query_type != TreeQueryType::erase) {
+            return;
+        }
+        if (current_step_ < log_.size()) {
+            log_.resize(current_step_);
+            while (checkpoints_.back().step > current_step_) {
+                checkpoints_.pop_back();
+            }
+        }
+        log_.push_back(query);
+        Apply(query);
+        ++current_step_;
+        if (current_step_ % checkpoint_interval_ == 0) {
+            AddCheckpoint();
+        }
+    }
+
+    void History::GoToStep(size_t step, Model& model) {
+        PRINT_WHERE_AM_I();
+        assert(step <= log_.size());
+        auto checkpoint = std::upper_bound(
+                checkpoints_.begin(), checkpoints_.end(), step,
+                [](size_t lhs, const Checkpoint& rhs) { return lhs < rhs.step; });
+        assert(checkpoint != checkpoints_.begin());
+        --checkpoint;
+        size_t from = checkpoint->step;
+        if (checkpoint->step <= current_step_ && current_step_ <= step) {
+            from = current_step_;
+        } else {
+            shadow_.Restore(checkpoint->version);
+        }
+        for (size_t i = from; i < step; ++i) {
+            Apply(log_[i]);
+        }
+        last_replay_length_ = step - from;
+        current_step_ = step;
+        model.BuildFromSorted(shadow_.begin(), shadow_.end());
+    }
+
+    size_t History::StepCount() const {
+        return log_.size();
+    }
+
+    size_t History::CurrentStep() const {
+        return current_step_;
+    }
+
+    size_t History::CheckpointCount() const {
+        return checkpoints_.size();
+    }
+
+    size_t History::CheckpointInterval() const {
+        return checkpoint_interval_;
+    }
+
+    size_t History::LastReplayLength() const {
+        return last_replay_length_;
+    }
+
+    void History::Apply(const TreeQuery& query) {
+        if (query.query_type == TreeQueryType::insert) {
+            shadow_.Insert(query.value);
+        } else {
+            shadow_.Erase(query.value);
+        }
+    }
+
+    void History::AddCheckpoint() {
+        checkpoints_.push_back(Checkpoint{current_step_, shadow_.Snapshot()});
+        if (checkpoints_.size() <= max_checkpoints_) {
+            return;
+        }
+        checkpoint_interval_ *= 2;
+        std::erase_if(checkpoints_, [this](const Checkpoint& checkpoint) {
+            return checkpoint.step % checkpoint_interval_ != 0;
+        });
+    }
+}// namespace DSVisualization
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "persistent_red_black_tree.h"
+#include "queries.h"
+#include "red_black_tree.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace DSVisualization {
+    // Log of the mutating queries of a session with checkpoints to jump between its steps. A
+    // persistent copy of the model follows the log, so a checkpoint is an O(1) snapshot of it,
+    // taken every CheckpointInterval() steps. When there are more than max_checkpoints of them,
+    // every other checkpoint is dropped and the interval is doubled, so the memory stays bounded
+    // and a jump replays at most CheckpointInterval() queries.
+    class History {
+        using Model =
+                RedBlackTree<int, Tracing, std::allocator<int>, NoAugmentation, std::less<int>>;
+        using Shadow = PersistentRedBlackTree<int>;
+
+    public:
+        static constexpr size_t default_max_checkpoints = 64;
+        static constexpr size_t default_checkpoint_interval = 256;
+
+        explicit History(size_t max_checkpoints = default_max_checkpoints,
+                         size_t checkpoint_interval = default_checkpoint_interval);
+
+        // Adds the query after the current step. If the history was rewound, the steps after
+        // the current one are forgotten. Queries which don't change the tree are ignored.
+        void Record(const TreeQuery& query);
+
+        // Brings the model to the state after the first step queries, the model sends one tree
+        // info to its subscribers
+        void GoToStep(size_t step, Model& model);
+
+        [[nodiscard]] size_t StepCount() const;
+        [[nodiscard]] size_t CurrentStep() const;
+        [[nodiscard]] size_t CheckpointCount() const;
+        [[nodiscard]] size_t CheckpointInterval() const;
+
+        // Number of queries replayed by the last GoToStep
+        [[nodiscard]] size_t LastReplayLength() const;
+
+    private:
+        struct Checkpoint {
+            size_t step;
+            Shadow::Version version;
+        };
+
+        void Apply(const TreeQuery& query);
+        void AddCheckpoint();
+
+        std::vector<TreeQuery> log_;
+        std::vector<Checkpoint> checkpoints_;
+        Shadow shadow_;
+        size_t current_step_ = 0;
+        size_t max_checkpoints_;
+        size_t checkpoint_interval_;
+        size_t last_replay_length_ = 0;
+    };
+}// namespace DSVisualization
@@ -0,0 +1,215 @@
+#pragma once
+
+#include "event_pipeline.h"
+#include "red_black_tree.h"
+#include "tree_layout.h"
+#include "tree_mirror.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace DSVisualization {
+    // Lays out the frames of a model on a thread of its own, so that the thread of a view only
+    // draws them. The worker is the consumer of the pipeline: it applies the events to a
+    // TreeMirror and a TreeLayout and builds a Frame from them at the steps the view asks for.
+    // A published frame is immutable, the view takes the newest one and a frame it has not
+    // taken before the next one is published is dropped. When the view asks for several frames
+    // before the worker gets to them, only the last of them is built. The frames are reused
+    // once the view has let them go, so building one allocates nothing in the steady state.
+    template<typename T, typename Frame>
+    class LayoutWorker {
+    public:
+        using Event = typename TreeMirror<T>::Event;
+        // Fills the frame from the mirror and the layout, the frame may hold an older frame
+        using Builder = std::function<void(const TreeMirror<T>&, const TreeLayout<T>&, Frame*)>;
+        // Called on the thread of the worker after a frame is published
+        using Callback = std::function<void()>;
+
+        LayoutWorker(EventPipeline<Event>* pipeline, Builder builder, Callback on_ready = {})
+            : pipeline_(pipeline), builder_(std::move(builder)), on_ready_(std::move(on_ready)),
+              thread_([this]() {
+                  Run();
+              }) {
+        }
+
+        LayoutWorker(const LayoutWorker&) = delete;
+        LayoutWorker& operator=(const LayoutWorker&) = delete;
+        LayoutWorker(LayoutWorker&&) = delete;
+        LayoutWorker& operator=(LayoutWorker&&) = delete;
+
+        ~LayoutWorker() {
+            {
+                std::lock_guard lock(mutex_);
+                stopped_.store(true, std::memory_order_relaxed);
+            }
+            condition_.notify_one();
+            thread_.join();
+        }
+
+        // Asks for the next frame, nothing is published if the model hasn't sent it yet
+        void RequestFrame() {
+            {
+                std::lock_guard lock(mutex_);
+                ++requested_frames_;
+            }
+            condition_.notify_one();
+        }
+
+        // Asks for the last frame the model has sent, the frames before it are skipped
+        void RequestLastFrame() {
+            {
+                std::lock_guard lock(mutex_);
+                skip_ = true;
+            }
+            condition_.notify_one();
+        }
+
+        // The newest published frame, nullptr if none was published since the last call
+        [[nodiscard]] std::shared_ptr<const Frame> TakeFrame() {
+            std::lock_guard lock(mutex_);
+            return std::exchange(ready_frame_, nullptr);
+        }
+
+        [[nodiscard]] size_t BuiltFrames() const {
+            return built_frames_.load(std::memory_order_relaxed);
+        }
+
+        // The frames skipped without being built and the built ones never taken
+        [[nodiscard]] size_t DroppedFrames() const {
+            return dropped_frames_.load(std::memory_order_relaxed);
+        }
+
+    private:
+        static constexpr std::chrono::milliseconds wait_for_events{1};
+        static constexpr size_t max_free_frames = 3;
+
+        void Run() {
+            std::unique_lock lock(mutex_);
+            while (true) {
+                condition_.wait(lock, [this]() {
+                    return stopped_.load(std::memory_order_relaxed) || skip_ ||
+                           requested_frames_ > 0;
+                });
+                if (stopped_.load(std::memory_order_relaxed)) {
+                    return;
+                }
+                bool skip = std::exchange(skip_, false);
+                size_t requested_frames = std::exchange(requested_frames_, 0);
+                lock.unlock();
+                size_t ended_frames = skip ? ApplyAll() : ApplyFrames(requested_frames);
+                if (ended_frames > 0) {
+                    dropped_frames_.fetch_add(ended_frames - 1, std::memory_order_relaxed);
+                    Publish();
+                }
+                lock.lock();
+            }
+        }
+
+        // Returns the number of the frames which ended
+        size_t ApplyFrames(size_t count) {
+            size_t ended_frames = 0;
+            Event event;
+            while (ended_frames < count && pipeline_->TryPop(&event)) {
+                if (Apply(event)) {
+                    ++ended_frames;
+                }
+            }
+            return ended_frames;
+        }
+
+        size_t ApplyAll() {
+            size_t ended_frames = 0;
+            Event event;
+            while (!stopped_.load(std::memory_order_relaxed)) {
+                if (pipeline_->TryPop(&event)) {
+                    if (Apply(event)) {
+                        ++ended_frames;
+                    }
+                } else if (mid_frame_ && !pipeline_->IsClosed()) {
+                    // The rest of the frame is on its way from the model
+                    std::this_thread::sleep_for(wait_for_events);
+                } else {
+                    break;
+                }
+            }
+            return ended_frames;
+        }
+
+        bool Apply(const Event& event) {
+            layout_.Apply(event);
+            bool frame_ended = mirror_.Apply(event);
+            if (event.type == TreeEventType::operation_started) {
+                ++depth_;
+            } else if (event.type == TreeEventType::operation_finished) {
+                --depth_;
+            }
+            // The last step of an operation comes right before its end
+            mid_frame_ = !frame_ended &&
+                         !(event.type == TreeEventType::operation_finished && depth_ == 0);
+            return frame_ended;
+        }
+
+        void Publish() {
+            std::shared_ptr<Frame> frame = FreeFrame();
+            builder_(mirror_, layout_, frame.get());
+            bool dropped = false;
+            {
+                std::lock_guard lock(mutex_);
+                dropped = ready_frame_ != nullptr;
+                ready_frame_ = frame;
+            }
+            built_frames_.fetch_add(1, std::memory_order_relaxed);
+            if (dropped) {
+                dropped_frames_.fetch_add(1, std::memory_order_relaxed);
+            }
+            if (on_ready_) {
+                on_ready_();
+            }
+        }
+
+        // A frame nobody else holds, the view lets the frames go on its own thread
+        std::shared_ptr<Frame> FreeFrame() {
+            for (const std::shared_ptr<Frame>& frame : free_frames_) {
+                if (frame.use_count() == 1) {
+                    // Pairs with the release of the last other owner
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    return frame;
+                }
+            }
+            auto frame = std::make_shared<Frame>();
+            if (free_frames_.size() < max_free_frames) {
+                free_frames_.push_back(frame);
+            }
+            return frame;
+        }
+
+        EventPipeline<Event>* pipeline_;
+        Builder builder_;
+        Callback on_ready_;
+        // The state of the worker thread
+        TreeMirror<T> mirror_;
+        TreeLayout<T> layout_;
+        size_t depth_ = 0;
+        bool mid_frame_ = false;
+        std::vector<std::shared_ptr<Frame>> free_frames_;
+        // Shared with the view
+        std::mutex mutex_;
+        std::condition_variable condition_;
+        std::atomic<bool> stopped_ = false;
+        bool skip_ = false;
+        size_t requested_frames_ = 0;
+        std::shared_ptr<const Frame> ready_frame_;
+        std::atomic<size_t> built_frames_ = 0;
+        std::atomic<size_t> dropped_frames_ = 0;
+        // The last member, it starts after the others are constructed
+        std::thread thread_;
+    };
+}// namespace DSVisualization
@@ -1,11 +1,16 @@
 #include "application.h"
 #include "utility.h"
 
+#include <memory>
+
 #include <QApplication>
 
 int main(int argc, char* argv[]) {
     QApplication q_app(argc, argv);
-    DSVisualization::Application app;
+    // An event log of data_structure_visualization_cli may be given to be played
+    std::unique_ptr<DSVisualization::Application> app =
+            argc > 1 ? std::make_unique<DSVisualization::Application>(argv[1])
+                     : std::make_unique<DSVisualization::Application>();
     QApplication::exec();
     PRINT_WHERE_AM_I();
     return 0;
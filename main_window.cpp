@@ -7,12 +7,22 @@ namespace DSVisualization {
     MainWindow::MainWindow()
         : QMainWindow(), main_layout_(new QGridLayout(this)), insert_button_(new QPushButton("Insert", this)),
           erase_button_(new QPushButton("Erase", this)), find_button_(new QPushButton("Find", this)),
+          step_button_(new QPushButton("Go to step", this)),
           insert_line_edit_(new QLineEdit(this)), erase_line_edit_(new QLineEdit(this)),
-          find_line_edit_(new QLineEdit(this)), tree_scene_(new QGraphicsScene(this)),
+          find_line_edit_(new QLineEdit(this)), step_line_edit_(new QLineEdit(this)),
+          pause_button_(new QPushButton("Pause", this)),
+          next_frame_button_(new QPushButton("Next frame", this)),
+          skip_button_(new QPushButton("Skip to end", this)),
+          speed_slider_(new QSlider(Qt::Horizontal, this)),
+          tree_scene_(new QGraphicsScene(this)),
           tree_view_(new QGraphicsView(tree_scene_, this)), main_scene_(new QGraphicsScene(this)),
           main_view_(new QGraphicsView(main_scene_)) {
         PRINT_WHERE_AM_I();
         setMinimumSize(default_width, default_height);
+        pause_button_->setCheckable(true);
+        speed_slider_->setRange(min_speed_power, max_speed_power);
+        speed_slider_->setValue(0);
+        speed_slider_->setToolTip("Speed");
         AddWidgetsToLayout();
         main_view_.setLayout(main_layout_);
         setCentralWidget(&main_view_);
@@ -24,9 +34,11 @@ namespace DSVisualization {
         insert_button_->setEnabled(flag);
         erase_button_->setEnabled(flag);
         find_button_->setEnabled(flag);
+        step_button_->setEnabled(flag);
         insert_line_edit_->setEnabled(flag);
         erase_line_edit_->setEnabled(flag);
         find_line_edit_->setEnabled(flag);
+        step_line_edit_->setEnabled(flag);
     }
 
     void MainWindow::DisableButtons() {
@@ -45,8 +57,14 @@ namespace DSVisualization {
         main_layout_->addWidget(insert_line_edit_, 1, 0);
         main_layout_->addWidget(erase_line_edit_, 1, 1);
         main_layout_->addWidget(find_line_edit_, 1, 2);
+        main_layout_->addWidget(step_line_edit_, 1, 3);
         main_layout_->addWidget(insert_button_, 2, 0);
         main_layout_->addWidget(erase_button_, 2, 1);
         main_layout_->addWidget(find_button_, 2, 2);
+        main_layout_->addWidget(step_button_, 2, 3);
+        main_layout_->addWidget(pause_button_, 3, 0);
+        main_layout_->addWidget(next_frame_button_, 3, 1);
+        main_layout_->addWidget(skip_button_, 3, 2);
+        main_layout_->addWidget(speed_slider_, 3, 3);
     }
 }// namespace DSVisualization
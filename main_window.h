@@ -6,6 +6,7 @@
 #include <QLineEdit>
 #include <QMainWindow>
 #include <QPushButton>
+#include <QSlider>
 
 namespace DSVisualization {
     class View;
@@ -30,15 +31,25 @@ namespace DSVisualization {
         static constexpr float default_width = 960;
         static constexpr float default_height = 540;
         static constexpr float margin = 40;
+        // The playback speed is 2 to the power of the slider value
+        static constexpr int min_speed_power = -2;
+        static constexpr int max_speed_power = 3;
         float current_width_ = default_width;
 
         QGridLayout* main_layout_;
         QPushButton* insert_button_;
         QPushButton* erase_button_;
         QPushButton* find_button_;
+        QPushButton* step_button_;
         QLineEdit* insert_line_edit_;
         QLineEdit* erase_line_edit_;
         QLineEdit* find_line_edit_;
+        QLineEdit* step_line_edit_;
+        // Playback of the animation, never disabled
+        QPushButton* pause_button_;
+        QPushButton* next_frame_button_;
+        QPushButton* skip_button_;
+        QSlider* speed_slider_;
         QGraphicsScene* tree_scene_;
         QGraphicsView* tree_view_;
         QGraphicsScene* main_scene_;
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <algorithm>
 #include <functional>
-#include <list>
+#include <memory>
+#include <vector>
 
 namespace DSVisualization {
     template<typename T>
@@ -22,7 +24,7 @@ namespace DSVisualization {
         Observable& operator=(Observer<T>&&) = delete;
         ~Observable() {
             while (!observers_.empty()) {
-                observers_.front()->Unsubscribe();
+                observers_.back()->Unsubscribe();
             }
         }
 
@@ -32,35 +34,58 @@ namespace DSVisualization {
             }
             observers_.push_back(obs);
             obs->SetObservable(this);
-            obs->on_subscribe_(data_());
+            CallWithData(obs->on_subscribe_);
         }
 
+        // Asks the data source once per observer
         void Notify() const {
-            for (auto obs : observers_) {
-                obs->on_notify_(data_());
+            for (size_t i = 0; i < observers_.size(); ++i) {
+                observers_[i]->on_notify_(data_());
             }
         }
 
-        void SendByReference(const T& data) {
-            data_ = [&data]() {
-                return data;
-            };
-            Notify();
+        // Hands the same data to all the observers without copying it. The reference is only
+        // valid during the call.
+        void SendByReference(const T& data) const {
+            for (size_t i = 0; i < observers_.size(); ++i) {
+                observers_[i]->on_notify_(data);
+            }
         }
 
         void SendByValue(T data) {
             data_ = [d = std::move(data)]() {
                 return d;
             };
+            // New observers get this data, not an older shared one
+            shared_.reset();
             Notify();
         }
 
+        // Hands the same data to all the observers without copying it. The observable keeps
+        // it, so the reference stays valid until the next Share or the end of the observable,
+        // and new observers get it on subscription.
+        void Share(std::shared_ptr<const T> data) {
+            shared_ = std::move(data);
+            SendByReference(*shared_);
+        }
+
     private:
         void Detach(Observer<T>* obs) {
-            obs->on_unsubscribe_(data_());
-            observers_.remove(obs);
+            CallWithData(obs->on_unsubscribe_);
+            observers_.erase(std::find(observers_.begin(), observers_.end(), obs));
         }
+
+        template<typename Action>
+        void CallWithData(const Action& action) const {
+            if (shared_) {
+                action(*shared_);
+            } else {
+                action(data_());
+            }
+        }
+
         std::function<T()> data_;
-        std::list<Observer<T>*> observers_;
+        std::shared_ptr<const T> shared_;
+        std::vector<Observer<T>*> observers_;
     };
 }// namespace DSVisualization
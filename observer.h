@@ -1,5 +1,8 @@
 #pragma once
 
+#include <functional>
+#include <utility>
+
 namespace DSVisualization {
     template<typename T>
     class Observable;
@@ -42,14 +45,14 @@ namespace DSVisualization {
             return observable_;
         }
 
-        static void do_nothing(T){};
+        static void do_nothing(const T&){};
 
     private:
         void SetObservable(Observable<T>* observable) {
             observable_ = observable;
         }
 
-        using Action = std::function<void(T)>;
+        using Action = std::function<void(const T&)>;
 
         Observable<T>* observable_ = nullptr;
         Action on_subscribe_ = do_nothing;
@@ -0,0 +1,579 @@
+#pragma once
+
+#include "red_black_tree.h"
+
+#include <atomic>
+#include <cassert>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#ifdef INVARIANTS_CHECK
+#include <algorithm>
+#endif
+
+namespace DSVisualization {
+    // Node of PersistentRedBlackTree. It never changes after it is built and can belong to many
+    // versions of the tree at once, ref_count counts the versions and the parent nodes holding
+    // it. There is no parent link, a node doesn't have a single parent.
+    template<typename T>
+    struct PersistentRedBlackTreeNode {
+        template<typename... Args>
+        explicit PersistentRedBlackTreeNode(Color color, const PersistentRedBlackTreeNode* left,
+                                            const PersistentRedBlackTreeNode* right,
+                                            Args&&... args)
+            : left(left),
+              right(right),
+              value(std::forward<Args>(args)...),
+              color(color),
+              size((left ? left->size : 0) + (right ? right->size : 0) + 1),
+              ref_count(1) {
+        }
+
+        void Print(std::ostream& os, int32_t depth) const {
+            static auto PrintLines = [](std::ostream& os, int32_t depth) {
+                if (depth > 0) {
+                    for (int32_t i = 1; i < depth; ++i) {
+                        os << "|   ";
+                    }
+                    os << "|---";
+                }
+            };
+            PrintLines(os, depth);
+            os << "(" << value << ", " << (color == Color::red ? 'r' : 'b') << ")\n";
+            for (const PersistentRedBlackTreeNode* kid : {left, right}) {
+                if (kid) {
+                    kid->Print(os, depth + 1);
+                } else {
+                    PrintLines(os, depth + 1);
+                    os << "(NIL, b)\n";
+                }
+            }
+        }
+
+        const PersistentRedBlackTreeNode* left;
+        const PersistentRedBlackTreeNode* right;
+        T value;
+        Color color;
+        // Number of nodes in the subtree of this node
+        size_t size;
+        mutable std::atomic<size_t> ref_count;
+    };
+
+    // Red-black tree keeping all its versions. Insert and Erase don't change any node: they
+    // build copies of the nodes on the search path and share the rest with the previous
+    // version, so they take O(log n) time and memory. Snapshot() is O(1) and gives an
+    // immutable version which stays valid while the tree keeps changing.
+    //
+    // Nodes are freed by whoever drops the last reference, which may be a reader on another
+    // thread. There are no locks, reference counts are atomic, so readers never block the
+    // writer. Snapshots can be freely copied and released on any thread, the tree itself has
+    // a single writer. The nodes are freed without the tree, so the allocator must be stateless.
+    //
+    // Insert and Erase follow the functional red-black tree of S. Kahrs, "Red-black trees with
+    // types", J. Functional Programming 11(4), 2001.
+    template<typename T, typename Compare = std::less<T>, typename Allocator = std::allocator<T>>
+    class PersistentRedBlackTree {
+    public:
+        using Node = PersistentRedBlackTreeNode<T>;
+        using Data = TreeInfo<T, NoAugmentation, Node>;
+
+    private:
+        using NodeAllocator =
+                typename std::allocator_traits<Allocator>::template rebind_alloc<Node>;
+        using NodeAllocatorTraits = std::allocator_traits<NodeAllocator>;
+
+        static_assert(NodeAllocatorTraits::is_always_equal::value,
+                      "nodes are freed by the last version holding them, without the tree");
+
+        // Owning reference to a node
+        class NodeRef {
+        public:
+            NodeRef() = default;
+
+            // Takes over a reference that is already counted
+            explicit NodeRef(const Node* node) : node_(node) {
+            }
+
+            // Counts one more reference to node
+            static NodeRef Share(const Node* node) {
+                if (node) {
+                    node->ref_count.fetch_add(1, std::memory_order_relaxed);
+                }
+                return NodeRef(node);
+            }
+
+            NodeRef(const NodeRef& other) : node_(Share(other.node_).Detach()) {
+            }
+
+            NodeRef(NodeRef&& other) noexcept : node_(other.Detach()) {
+            }
+
+            NodeRef& operator=(NodeRef other) noexcept {
+                std::swap(node_, other.node_);
+                return *this;
+            }
+
+            ~NodeRef() {
+                Unref(node_);
+            }
+
+            // Gives up the reference without dropping it
+            const Node* Detach() {
+                return std::exchange(node_, nullptr);
+            }
+
+            [[nodiscard]] const Node* Get() const {
+                return node_;
+            }
+
+            const Node* operator->() const {
+                return node_;
+            }
+
+            explicit operator bool() const {
+                return node_;
+            }
+
+        private:
+            const Node* node_ = nullptr;
+        };
+
+    public:
+        class ConstIterator;
+
+        // Immutable version of the tree
+        class Version {
+            friend PersistentRedBlackTree;
+
+        public:
+            Version() = default;
+
+            bool Find(const T& value) const {
+                const Node* node = root_.Get();
+                while (node) {
+                    if (compare_(value, node->value)) {
+                        node = node->left;
+                    } else if (compare_(node->value, value)) {
+                        node = node->right;
+                    } else {
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            [[nodiscard]] size_t Size() const {
+                return Root() ? Root()->size : 0;
+            }
+
+            [[nodiscard]] bool Empty() const {
+                return !Root();
+            }
+
+            [[nodiscard]] const Node* Root() const {
+                return root_.Get();
+            }
+
+            // The whole version for the view. The tree info holds the version, so the view can
+            // keep it as long as it needs.
+            [[nodiscard]] Data GetTreeInfo() const {
+                return Data{Size(), Root(), {}, std::make_shared<Version>(*this)};
+            }
+
+            ConstIterator begin() const {
+                return ConstIterator(Root());
+            }
+
+            ConstIterator end() const {
+                return ConstIterator(nullptr);
+            }
+
+#ifdef INVARIANTS_CHECK
+            [[nodiscard]] bool CheckInvariants() const {
+                if (Root() && Root()->color == Color::red) {
+                    return false;
+                }
+                std::vector<T> values;
+                std::vector<int32_t> depths;
+                if (!CheckInvariants(Root(), &values, &depths, 0)) {
+                    return false;
+                }
+                if (!std::is_sorted(values.begin(), values.end(), compare_)) {
+                    return false;
+                }
+                return *std::max_element(depths.begin(), depths.end()) ==
+                       *std::min_element(depths.begin(), depths.end());
+            }
+#endif
+
+            friend std::ostream& operator<<(std::ostream& os, const Version& version) {
+                if (!version.Root()) {
+                    return os << "Empty\n";
+                }
+                version.Root()->Print(os, 0);
+                return os;
+            }
+
+        private:
+            Version(NodeRef root, const Compare& compare)
+                : root_(std::move(root)), compare_(compare) {
+            }
+
+#ifdef INVARIANTS_CHECK
+            static bool CheckInvariants(const Node* node, std::vector<T>* values,
+                                        std::vector<int32_t>* depths, int32_t black_depth) {
+                if (!node) {
+                    depths->push_back(black_depth + 1);
+                    return true;
+                }
+                if (node->size != (node->left ? node->left->size : 0) +
+                                          (node->right ? node->right->size : 0) + 1) {
+                    return false;
+                }
+                if (node->color == Color::black) {
+                    ++black_depth;
+                } else if (IsRed(node->left) || IsRed(node->right)) {
+                    return false;
+                }
+                if (!CheckInvariants(node->left, values, depths, black_depth)) {
+                    return false;
+                }
+                values->push_back(node->value);
+                return CheckInvariants(node->right, values, depths, black_depth);
+            }
+#endif
+
+            NodeRef root_;
+            [[no_unique_address]] Compare compare_;
+        };
+
+        // Forward iterator over the values of a version. The version must outlive it.
+        class ConstIterator {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = T;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const T*;
+            using reference = const T&;
+
+            ConstIterator() = default;
+
+            explicit ConstIterator(const Node* root) {
+                PushLeftPath(root);
+            }
+
+            ConstIterator& operator++() {
+                assert(!path_.empty());
+                const Node* node = path_.back();
+                path_.pop_back();
+                PushLeftPath(node->right);
+                return *this;
+            }
+
+            ConstIterator operator++(int) {
+                ConstIterator result = *this;
+                ++*this;
+                return result;
+            }
+
+            bool operator==(const ConstIterator& other) const {
+                return path_ == other.path_;
+            }
+
+            reference operator*() const {
+                return path_.back()->value;
+            }
+
+            pointer operator->() const {
+                return &path_.back()->value;
+            }
+
+        private:
+            void PushLeftPath(const Node* node) {
+                for (; node; node = node->left) {
+                    path_.push_back(node);
+                }
+            }
+
+            // The nodes whose left subtrees are being visited, the current one is the last
+            std::vector<const Node*> path_;
+        };
+
+        PersistentRedBlackTree() = default;
+
+        explicit PersistentRedBlackTree(const Compare& compare) : current_({}, compare) {
+        }
+
+        bool Insert(const T& value) {
+            if (Find(value)) {
+                return false;
+            }
+            current_.root_ = Blacken(InsertInto(Root(), value));
+            return true;
+        }
+
+        bool Erase(const T& value) {
+            if (!Find(value)) {
+                return false;
+            }
+            current_.root_ = Blacken(EraseFrom(Root(), value));
+            return true;
+        }
+
+        bool Find(const T& value) const {
+            return current_.Find(value);
+        }
+
+        [[nodiscard]] size_t Size() const {
+            return current_.Size();
+        }
+
+        [[nodiscard]] bool Empty() const {
+            return current_.Empty();
+        }
+
+        [[nodiscard]] const Node* Root() const {
+            return current_.Root();
+        }
+
+        // The current version in O(1)
+        [[nodiscard]] Version Snapshot() const {
+            return current_;
+        }
+
+        // Goes back to an earlier version, the versions after it stay valid
+        void Restore(const Version& version) {
+            current_ = version;
+        }
+
+        void Clear() {
+            current_.root_ = NodeRef();
+        }
+
+        ConstIterator begin() const {
+            return current_.begin();
+        }
+
+        ConstIterator end() const {
+            return current_.end();
+        }
+
+#ifdef INVARIANTS_CHECK
+        [[nodiscard]] bool CheckInvariants() const {
+            return current_.CheckInvariants();
+        }
+#endif
+
+        friend std::ostream& operator<<(std::ostream& os, const PersistentRedBlackTree& t) {
+            return os << t.current_;
+        }
+
+    private:
+        static bool IsRed(const Node* node) {
+            return node && node->color == Color::red;
+        }
+
+        static bool IsBlack(const Node* node) {
+            return node && node->color == Color::black;
+        }
+
+        // Drops one reference to node, the nodes left without references are freed
+        static void Unref(const Node* node) {
+            while (node && node->ref_count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                Unref(node->left);
+                const Node* right = node->right;
+                NodeAllocator allocator;
+                Node* mutable_node = const_cast<Node*>(node);
+                NodeAllocatorTraits::destroy(allocator, mutable_node);
+                NodeAllocatorTraits::deallocate(allocator, mutable_node, 1);
+                node = right;
+            }
+        }
+
+        // A new node taking over the references to its kids
+        template<typename... Args>
+        static NodeRef MakeNode(Color color, NodeRef left, NodeRef right, Args&&... args) {
+            NodeAllocator allocator;
+            Node* node = NodeAllocatorTraits::allocate(allocator, 1);
+            NodeAllocatorTraits::construct(allocator, node, color, left.Detach(), right.Detach(),
+                                           std::forward<Args>(args)...);
+            return NodeRef(node);
+        }
+
+        static NodeRef Share(const Node* node) {
+            return NodeRef::Share(node);
+        }
+
+        // The same node with the given color, copied unless it already has it
+        static NodeRef Recolor(NodeRef node, Color color) {
+            if (node->color == color) {
+                return node;
+            }
+            return MakeNode(color, Share(node->left), Share(node->right), node->value);
+        }
+
+        static NodeRef Blacken(NodeRef node) {
+            return node ? Recolor(std::move(node), Color::black) : NodeRef();
+        }
+
+        // A black node, which the red kids are rebalanced under
+        static NodeRef Balance(NodeRef left, const T& value, NodeRef right) {
+            if (IsRed(left.Get()) && IsRed(right.Get())) {
+                return MakeNode(Color::red, Recolor(std::move(left), Color::black),
+                                Recolor(std::move(right), Color::black), value);
+            }
+            if (IsRed(left.Get()) && IsRed(left->left)) {
+                return MakeNode(Color::red, Recolor(Share(left->left), Color::black),
+                                MakeNode(Color::black, Share(left->right), std::move(right), value),
+                                left->value);
+            }
+            if (IsRed(left.Get()) && IsRed(left->right)) {
+                return MakeNode(Color::red,
+                                MakeNode(Color::black, Share(left->left),
+                                         Share(left->right->left), left->value),
+                                MakeNode(Color::black, Share(left->right->right),
+                                         std::move(right), value),
+                                left->right->value);
+            }
+            if (IsRed(right.Get()) && IsRed(right->right)) {
+                return MakeNode(Color::red,
+                                MakeNode(Color::black, std::move(left), Share(right->left), value),
+                                Recolor(Share(right->right), Color::black), right->value);
+            }
+            if (IsRed(right.Get()) && IsRed(right->left)) {
+                return MakeNode(Color::red,
+                                MakeNode(Color::black, std::move(left), Share(right->left->left),
+                                         value),
+                                MakeNode(Color::black, Share(right->left->right),
+                                         Share(right->right), right->value),
+                                right->left->value);
+            }
+            return MakeNode(Color::black, std::move(left), std::move(right), value);
+        }
+
+        NodeRef InsertInto(const Node* node, const T& value) const {
+            if (!node) {
+                return MakeNode(Color::red, NodeRef(), NodeRef(), value);
+            }
+            if (current_.compare_(value, node->value)) {
+                NodeRef left = InsertInto(node->left, value);
+                if (node->color == Color::black) {
+                    return Balance(std::move(left), node->value, Share(node->right));
+                }
+                return MakeNode(Color::red, std::move(left), Share(node->right), node->value);
+            }
+            NodeRef right = InsertInto(node->right, value);
+            if (node->color == Color::black) {
+                return Balance(Share(node->left), node->value, std::move(right));
+            }
+            return MakeNode(Color::red, Share(node->left), std::move(right), node->value);
+        }
+
+        // The subtree of node without value, which must be there. The black height of the
+        // result is one less if node is black, the root may be red with a red kid.
+        NodeRef EraseFrom(const Node* node, const T& value) const {
+            if (current_.compare_(value, node->value)) {
+                NodeRef left = EraseFrom(node->left, value);
+                if (IsBlack(node->left)) {
+                    return BalanceLeft(std::move(left), node->value, Share(node->right));
+                }
+                return MakeNode(Color::red, std::move(left), Share(node->right), node->value);
+            }
+            if (current_.compare_(node->value, value)) {
+                NodeRef right = EraseFrom(node->right, value);
+                if (IsBlack(node->right)) {
+                    return BalanceRight(Share(node->left), node->value, std::move(right));
+                }
+                return MakeNode(Color::red, Share(node->left), std::move(right), node->value);
+            }
+            return Append(node->left, node->right);
+        }
+
+        // Rebalances after the black height of left went down by one
+        static NodeRef BalanceLeft(NodeRef left, const T& value, NodeRef right) {
+            if (IsRed(left.Get())) {
+                return MakeNode(Color::red, Recolor(std::move(left), Color::black),
+                                std::move(right), value);
+            }
+            if (IsBlack(right.Get())) {
+                return Balance(std::move(left), value, Recolor(std::move(right), Color::red));
+            }
+            assert(IsRed(right.Get()) && IsBlack(right->left));
+            return MakeNode(Color::red,
+                            MakeNode(Color::black, std::move(left), Share(right->left->left),
+                                     value),
+                            Balance(Share(right->left->right), right->value,
+                                    Recolor(Share(right->right), Color::red)),
+                            right->left->value);
+        }
+
+        // Rebalances after the black height of right went down by one
+        static NodeRef BalanceRight(NodeRef left, const T& value, NodeRef right) {
+            if (IsRed(right.Get())) {
+                return MakeNode(Color::red, std::move(left),
+                                Recolor(std::move(right), Color::black), value);
+            }
+            if (IsBlack(left.Get())) {
+                return Balance(Recolor(std::move(left), Color::red), value, std::move(right));
+            }
+            assert(IsRed(left.Get()) && IsBlack(left->right));
+            return MakeNode(Color::red,
+                            Balance(Recolor(Share(left->left), Color::red), left->value,
+                                    Share(left->right->left)),
+                            MakeNode(Color::black, Share(left->right->right), std::move(right),
+                                     value),
+                            left->right->value);
+        }
+
+        // Merges the kids of an erased node, all the values of left are less than of right
+        static NodeRef Append(const Node* left, const Node* right) {
+            if (!left) {
+                return Share(right);
+            }
+            if (!right) {
+                return Share(left);
+            }
+            if (IsRed(left) && IsRed(right)) {
+                NodeRef middle = Append(left->right, right->left);
+                if (IsRed(middle.Get())) {
+                    return MakeNode(Color::red,
+                                    MakeNode(Color::red, Share(left->left), Share(middle->left),
+                                             left->value),
+                                    MakeNode(Color::red, Share(middle->right),
+                                             Share(right->right), right->value),
+                                    middle->value);
+                }
+                return MakeNode(Color::red, Share(left->left),
+                                MakeNode(Color::red, std::move(middle), Share(right->right),
+                                         right->value),
+                                left->value);
+            }
+            if (IsBlack(left) && IsBlack(right)) {
+                NodeRef middle = Append(left->right, right->left);
+                if (IsRed(middle.Get())) {
+                    return MakeNode(Color::red,
+                                    MakeNode(Color::black, Share(left->left), Share(middle->left),
+                                             left->value),
+                                    MakeNode(Color::black, Share(middle->right),
+                                             Share(right->right), right->value),
+                                    middle->value);
+                }
+                return BalanceLeft(Share(left->left), left->value,
+                                   MakeNode(Color::black, std::move(middle), Share(right->right),
+                                            right->value));
+            }
+            if (IsRed(right)) {
+                return MakeNode(Color::red, Append(left, right->left), Share(right->right),
+                                right->value);
+            }
+            return MakeNode(Color::red, Share(left->left), Append(left->right, right),
+                            left->value);
+        }
+
+        Version current_;
+    };
+}// namespace DSVisualization
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace DSVisualization {
+    // Pool of fixed-size blocks. Blocks are cut from big slabs and freed blocks are kept in an
+    // intrusive list to be reused by the next allocation. The block size is fixed by the first
+    // allocation, so a pool serves objects of one type (e.g. the nodes of one tree).
+    class BlockPool {
+    public:
+        static constexpr size_t default_blocks_per_slab = 1024;
+
+        explicit BlockPool(size_t blocks_per_slab = default_blocks_per_slab)
+            : blocks_per_slab_(blocks_per_slab) {
+            assert(blocks_per_slab_ > 0);
+        }
+
+        BlockPool(const BlockPool&) = delete;
+        BlockPool& operator=(const BlockPool&) = delete;
+        BlockPool(BlockPool&&) = delete;
+        BlockPool& operator=(BlockPool&&) = delete;
+
+        ~BlockPool() {
+            Release();
+        }
+
+        [[nodiscard]] bool Fits(size_t size, size_t alignment) {
+            if (block_size_ == 0) {
+                block_alignment_ = std::max(alignment, alignof(FreeBlock));
+                block_size_ = std::max(size, sizeof(FreeBlock));
+                block_size_ = (block_size_ + block_alignment_ - 1) / block_alignment_ *
+                              block_alignment_;
+            }
+            return size <= block_size_ && alignment <= block_alignment_;
+        }
+
+        void* Allocate() {
+            assert(block_size_ != 0);
+            if (free_list_) {
+                FreeBlock* block = free_list_;
+                free_list_ = block->next;
+                return block;
+            }
+            if (slab_position_ == slab_end_) {
+                AddSlab();
+            }
+            void* block = slab_position_;
+            slab_position_ += block_size_;
+            return block;
+        }
+
+        void Deallocate(void* block) {
+            free_list_ = ::new (block) FreeBlock{free_list_};
+        }
+
+        // Frees every slab at once. All the blocks handed out before become invalid.
+        void Release() {
+            for (std::byte* slab : slabs_) {
+                ::operator delete(slab, std::align_val_t(block_alignment_));
+            }
+            slabs_.clear();
+            free_list_ = nullptr;
+            slab_position_ = nullptr;
+            slab_end_ = nullptr;
+        }
+
+        [[nodiscard]] size_t SlabCount() const {
+            return slabs_.size();
+        }
+
+    private:
+        struct FreeBlock {
+            FreeBlock* next;
+        };
+
+        void AddSlab() {
+            size_t slab_size = block_size_ * blocks_per_slab_;
+            auto* slab = static_cast<std::byte*>(
+                    ::operator new(slab_size, std::align_val_t(block_alignment_)));
+            slabs_.push_back(slab);
+            slab_position_ = slab;
+            slab_end_ = slab + slab_size;
+        }
+
+        size_t blocks_per_slab_;
+        size_t block_size_ = 0;
+        size_t block_alignment_ = 0;
+        FreeBlock* free_list_ = nullptr;
+        std::byte* slab_position_ = nullptr;
+        std::byte* slab_end_ = nullptr;
+        std::vector<std::byte*> slabs_;
+    };
+
+    // Allocator handing out single objects from a shared BlockPool. Copies and rebound copies
+    // share the pool; requests for arrays or for objects that don't fit the pool's block go to
+    // the global operator new.
+    template<typename T>
+    class PoolAllocator {
+        template<typename U>
+        friend class PoolAllocator;
+
+    public:
+        using value_type = T;
+
+        PoolAllocator() : PoolAllocator(BlockPool::default_blocks_per_slab) {
+        }
+
+        explicit PoolAllocator(size_t blocks_per_slab)
+            : pool_(std::make_shared<BlockPool>(blocks_per_slab)) {
+        }
+
+        template<typename U>
+        PoolAllocator(const PoolAllocator<U>& other) : pool_(other.pool_) {
+        }
+
+        T* allocate(size_t n) {
+            if (n == 1 && pool_->Fits(sizeof(T), alignof(T))) {
+                return static_cast<T*>(pool_->Allocate());
+            }
+            return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(alignof(T))));
+        }
+
+        void deallocate(T* ptr, size_t n) {
+            if (n == 1 && pool_->Fits(sizeof(T), alignof(T))) {
+                pool_->Deallocate(ptr);
+                return;
+            }
+            ::operator delete(ptr, std::align_val_t(alignof(T)));
+        }
+
+        // Drops the whole pool if no other allocator shares it. Objects living in the pool are
+        // not destroyed.
+        bool ReleaseIfUnique() {
+            if (pool_.use_count() != 1) {
+                return false;
+            }
+            pool_->Release();
+            return true;
+        }
+
+        [[nodiscard]] const BlockPool& Pool() const {
+            return *pool_;
+        }
+
+        template<typename U>
+        bool operator==(const PoolAllocator<U>& other) const {
+            return pool_ == other.pool_;
+        }
+
+    private:
+        std::shared_ptr<BlockPool> pool_;
+    };
+}// namespace DSVisualization
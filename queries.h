@@ -3,7 +3,7 @@
 #include <cstdint>
 
 namespace DSVisualization {
-    enum class TreeQueryType { do_nothing, insert, erase, find };
+    enum class TreeQueryType { do_nothing, insert, erase, find, go_to_step };
     struct TreeQuery {
         TreeQueryType query_type = TreeQueryType::do_nothing;
         int value = 0;
@@ -0,0 +1,262 @@
+#pragma once
+
+#include "red_black_tree.h"
+
+#include <functional>
+#include <memory>
+#include <utility>
+
+namespace DSVisualization {
+    // Orders the entries of RedBlackMap by their keys with Compare. Entries can be compared
+    // with bare keys as well, so the map looks them up without building an entry.
+    template<typename K, typename V, typename Compare>
+    struct MapKeyCompare {
+        using is_transparent = void;
+        using Entry = std::pair<const K, V>;
+
+        static const K& KeyOf(const Entry& entry) {
+            return entry.first;
+        }
+
+        template<typename Key>
+        static const Key& KeyOf(const Key& key) {
+            return key;
+        }
+
+        template<typename Lhs, typename Rhs>
+        bool operator()(const Lhs& lhs, const Rhs& rhs) const {
+            return compare(KeyOf(lhs), KeyOf(rhs));
+        }
+
+        [[no_unique_address]] Compare compare;
+    };
+
+    // Key/value form of RedBlackTree. With a transparent Compare (the default std::less<>)
+    // Find, Get and Erase take any key type comparable with K, e.g. std::string_view for
+    // std::string keys, without building a temporary K.
+    template<typename K, typename V, typename Compare = std::less<>,
+             typename TracingPolicy = Tracing,
+             typename Allocator = std::allocator<std::pair<const K, V>>>
+    class RedBlackMap {
+    public:
+        using Entry = std::pair<const K, V>;
+        using Tree =
+                RedBlackTree<Entry, TracingPolicy, Allocator, NoAugmentation,
+                             MapKeyCompare<K, V, Compare>>;
+        using NodePtr = typename Tree::NodePtr;
+        using Iterator = typename Tree::Iterator;
+        using ConstIterator = typename Tree::ConstIterator;
+        using ReverseIterator = typename Tree::ReverseIterator;
+        using ConstReverseIterator = typename Tree::ConstReverseIterator;
+
+        RedBlackMap() : RedBlackMap(Compare()) {
+        }
+
+        explicit RedBlackMap(const Compare& compare, const Allocator& allocator = Allocator())
+            : tree_(MapKeyCompare<K, V, Compare>{compare}, allocator) {
+        }
+
+        void SubscribeToEvents(typename Tree::ObserverModelViewPtr observer)
+            requires TracingPolicy::enabled
+        {
+            tree_.SubscribeToEvents(observer);
+        }
+
+        bool Insert(const Entry& entry) {
+            return tree_.Insert(entry);
+        }
+
+        bool Insert(Entry&& entry) {
+            return tree_.Insert(std::move(entry));
+        }
+
+        Iterator Insert(ConstIterator hint, const Entry& entry) {
+            return tree_.Insert(hint, entry);
+        }
+
+        Iterator Insert(ConstIterator hint, Entry&& entry) {
+            return tree_.Insert(hint, std::move(entry));
+        }
+
+        // Constructs the entry in place, e.g. Emplace(key, value) or
+        // Emplace(std::piecewise_construct, ...)
+        template<typename... Args>
+        bool Emplace(Args&&... args) {
+            return tree_.Emplace(std::forward<Args>(args)...);
+        }
+
+        bool Erase(const K& key) {
+            return tree_.Erase(key);
+        }
+
+        template<typename Key>
+            requires TransparentCompare<Compare>
+        bool Erase(const Key& key) {
+            return tree_.Erase(key);
+        }
+
+        Iterator Erase(ConstIterator pos) {
+            return tree_.Erase(pos);
+        }
+
+        Iterator Erase(Iterator pos) {
+            return tree_.Erase(pos);
+        }
+
+        Iterator Erase(ConstIterator first, ConstIterator last) {
+            return tree_.Erase(first, last);
+        }
+
+        bool Find(const K& key) {
+            return tree_.Find(key);
+        }
+
+        template<typename Key>
+            requires TransparentCompare<Compare>
+        bool Find(const Key& key) {
+            return tree_.Find(key);
+        }
+
+        // The value of key, nullptr if there is none. Unlike Find, it is not traced.
+        V* Get(const K& key) {
+            return const_cast<V*>(GetValue(key));
+        }
+
+        const V* Get(const K& key) const {
+            return GetValue(key);
+        }
+
+        template<typename Key>
+            requires TransparentCompare<Compare>
+        V* Get(const Key& key) {
+            return const_cast<V*>(GetValue(key));
+        }
+
+        template<typename Key>
+            requires TransparentCompare<Compare>
+        const V* Get(const Key& key) const {
+            return GetValue(key);
+        }
+
+        [[nodiscard]] size_t Size() const {
+            return tree_.Size();
+        }
+
+        [[nodiscard]] bool Empty() const {
+            return tree_.Empty();
+        }
+
+        void Clear() {
+            tree_.Clear();
+        }
+
+        NodePtr Root() {
+            return tree_.Root();
+        }
+
+        Iterator LowerBound(const K& key) {
+            return tree_.LowerBound(key);
+        }
+
+        ConstIterator LowerBound(const K& key) const {
+            return tree_.LowerBound(key);
+        }
+
+        template<typename Key>
+            requires TransparentCompare<Compare>
+        Iterator LowerBound(const Key& key) {
+            return tree_.LowerBound(key);
+        }
+
+        template<typename Key>
+            requires TransparentCompare<Compare>
+        ConstIterator LowerBound(const Key& key) const {
+            return tree_.LowerBound(key);
+        }
+
+        Iterator UpperBound(const K& key) {
+            return tree_.UpperBound(key);
+        }
+
+        ConstIterator UpperBound(const K& key) const {
+            return tree_.UpperBound(key);
+        }
+
+        template<typename Key>
+            requires TransparentCompare<Compare>
+        Iterator UpperBound(const Key& key) {
+            return tree_.UpperBound(key);
+        }
+
+        template<typename Key>
+            requires TransparentCompare<Compare>
+        ConstIterator UpperBound(const Key& key) const {
+            return tree_.UpperBound(key);
+        }
+
+        std::pair<Iterator, Iterator> EqualRange(const K& key) {
+            return tree_.EqualRange(key);
+        }
+
+        std::pair<ConstIterator, ConstIterator> EqualRange(const K& key) const {
+            return tree_.EqualRange(key);
+        }
+
+        template<typename Key>
+            requires TransparentCompare<Compare>
+        std::pair<Iterator, Iterator> EqualRange(const Key& key) {
+            return tree_.EqualRange(key);
+        }
+
+        template<typename Key>
+            requires TransparentCompare<Compare>
+        std::pair<ConstIterator, ConstIterator> EqualRange(const Key& key) const {
+            return tree_.EqualRange(key);
+        }
+
+        Iterator begin() {
+            return tree_.begin();
+        }
+
+        ConstIterator begin() const {
+            return tree_.begin();
+        }
+
+        Iterator end() {
+            return tree_.end();
+        }
+
+        ConstIterator end() const {
+            return tree_.end();
+        }
+
+        ReverseIterator rbegin() {
+            return tree_.rbegin();
+        }
+
+        ConstReverseIterator rbegin() const {
+            return tree_.rbegin();
+        }
+
+        ReverseIterator rend() {
+            return tree_.rend();
+        }
+
+        ConstReverseIterator rend() const {
+            return tree_.rend();
+        }
+
+    private:
+        // Searches with the comparator of the tree, which holds the one given to the map
+        template<typename Key>
+        const V* GetValue(const Key& key) const {
+            ConstIterator it = tree_.LowerBound(key);
+            if (it == tree_.end() || tree_.GetCompare()(key, *it)) {
+                return nullptr;
+            }
+            return &it->second;
+        }
+
+        Tree tree_;
+    };
+}// namespace DSVisualization
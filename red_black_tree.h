@@ -4,246 +4,1456 @@
 #include "observer.h"
 #include "utility.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <functional>
 #include <iostream>
+#include <iterator>
 #include <map>
 #include <memory>
+#include <optional>
 #include <sstream>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
-#ifdef INVARIANTS_CHECK
-#include <algorithm>
-#include <optional>
-#endif
-
 namespace DSVisualization {
     enum class Color { red, black };
     enum class Status { initial, touched, current, to_delete, rotate, found };
     enum class Kid { left, right, non };
 
-    template<typename T>
-    struct TreeInfo;
+    // Augmentation of RedBlackTree that keeps nothing in the nodes. An augmentation keeps in
+    // every node Augmentation::Combine folded over Augmentation::Lift of the values of its
+    // subtree, Combine must be associative.
+    struct NoAugmentation {
+        struct Value {};
+
+        template<typename T>
+        static Value Lift(const T&) {
+            return {};
+        }
+
+        static Value Combine(const Value&, const Value&) {
+            return {};
+        }
+    };
+
+    // Augmentation folding the values themselves with a default constructible CombineFunction,
+    // e.g. std::plus<> for range sums
+    template<typename T, typename CombineFunction>
+    struct CombineAugmentation {
+        using Value = T;
+
+        static const Value& Lift(const T& value) {
+            return value;
+        }
+
+        static Value Combine(const Value& lhs, const Value& rhs) {
+            return CombineFunction()(lhs, rhs);
+        }
+    };
+
+    // Comparators with is_transparent let RedBlackTree look up values by keys of other types,
+    // the same as for the standard associative containers
+    template<typename Compare>
+    concept TransparentCompare = requires { typename Compare::is_transparent; };
+
+    template<typename T, typename Augmentation = NoAugmentation>
+    struct RedBlackTreeNode;
+
+    template<typename T, typename Augmentation = NoAugmentation,
+             typename NodeType = RedBlackTreeNode<T, Augmentation>>
+    struct TreeInfo;
+
+    template<typename T, typename Augmentation = NoAugmentation>
+    class TreeEventTracer;
+
+    enum class TreeEventType {
+        operation_started,
+        operation_finished,
+        tree_replaced,
+        node_created,
+        status_changed,
+        recolor,
+        link_changed,
+        rotation,
+        node_destroyed,
+        step
+    };
+
+    // Copy of a value kept in an event. Events are assigned, so the key of a map entry loses
+    // its const.
+    template<typename T>
+    struct EventValue {
+        using Type = T;
+    };
+
+    template<typename K, typename V>
+    struct EventValue<std::pair<const K, V>> {
+        using Type = std::pair<K, V>;
+    };
+
+    // One change of a traced RedBlackTree. Insert, Erase and Find send one event per changed
+    // status, color or link, so a subscriber can keep its own picture of the tree up to date
+    // in O(1) per event, e.g. with TreeInfoBuilder. BuildFromSorted and Clear replace the whole
+    // tree and send tree_replaced followed by all the nodes of the new tree instead. Join sends
+    // the nodes it brings in as created ones before linking them, Split and range Erase send
+    // the nodes which leave the tree as destroyed ones. The events never need the nodes to be
+    // read, so they can be handled on another thread, e.g. by TreeMirror.
+    template<typename NodeType>
+    struct TreeEvent {
+        using Node = NodeType;
+        using Value = typename EventValue<typename Node::ValueType>::Type;
+
+        // An operation with its own statuses begins, they are dropped at operation_finished.
+        // Operations nest, e.g. a rotation inside an insert.
+        static TreeEvent OperationStarted(const Node* root, size_t tree_size) {
+            TreeEvent event;
+            event.type = TreeEventType::operation_started;
+            event.node = root;
+            event.tree_size = tree_size;
+            return event;
+        }
+
+        static TreeEvent OperationFinished() {
+            TreeEvent event;
+            event.type = TreeEventType::operation_finished;
+            return event;
+        }
+
+        // The whole tree may be new, nothing known about its nodes is valid anymore
+        static TreeEvent TreeReplaced(const Node* root, size_t tree_size) {
+            TreeEvent event;
+            event.type = TreeEventType::tree_replaced;
+            event.node = root;
+            event.tree_size = tree_size;
+            return event;
+        }
+
+        static TreeEvent NodeCreated(const Node* node, const Value& value, Color color) {
+            TreeEvent event;
+            event.type = TreeEventType::node_created;
+            event.node = node;
+            event.value = value;
+            event.color = color;
+            return event;
+        }
+
+        static TreeEvent StatusChanged(const Node* node, Status status) {
+            TreeEvent event;
+            event.type = TreeEventType::status_changed;
+            event.node = node;
+            event.status = status;
+            return event;
+        }
+
+        static TreeEvent Recolor(const Node* node, Color color) {
+            TreeEvent event;
+            event.type = TreeEventType::recolor;
+            event.node = node;
+            event.color = color;
+            return event;
+        }
+
+        // The kid of parent on the given side is now kid. A null parent stands for the root.
+        static TreeEvent LinkChanged(const Node* parent, Kid side, const Node* kid) {
+            TreeEvent event;
+            event.type = TreeEventType::link_changed;
+            event.node = parent;
+            event.kid = side;
+            event.other = kid;
+            return event;
+        }
+
+        // The node went up and its old parent went down to the given side. The changed links
+        // follow as link_changed events.
+        static TreeEvent Rotation(const Node* node, Kid direction) {
+            TreeEvent event;
+            event.type = TreeEventType::rotation;
+            event.node = node;
+            event.kid = direction;
+            return event;
+        }
+
+        // Sent right before the node is freed or moved to another tree by Split, the pointer
+        // may be reused after it
+        static TreeEvent NodeDestroyed(const Node* node) {
+            TreeEvent event;
+            event.type = TreeEventType::node_destroyed;
+            event.node = node;
+            return event;
+        }
+
+        // The events since the previous step make one frame of the animation
+        static TreeEvent Step(size_t tree_size) {
+            TreeEvent event;
+            event.type = TreeEventType::step;
+            event.tree_size = tree_size;
+            return event;
+        }
+
+        TreeEventType type = TreeEventType::step;
+        const Node* node = nullptr;
+        const Node* other = nullptr;
+        size_t tree_size = 0;
+        std::optional<Value> value;
+        Kid kid = Kid::non;
+        Status status = Status::initial;
+        Color color = Color::black;
+    };
+
+    // Tracing policies of RedBlackTree. With Tracing every step of an operation is sent to
+    // the subscribers as TreeEvents, with NoTracing all of it is compiled out.
+    struct Tracing {
+        static constexpr bool enabled = true;
+    };
+
+    struct NoTracing {
+        static constexpr bool enabled = false;
+    };
+
+    // Limits the frames of a traced tree to a rate. A step is delivered only if the last
+    // delivered one is at least a period old, and otherwise held back, so its changes are
+    // merged into the next delivered frame. The events of an operation are held together with
+    // the steps and flushed in one go right before the step which shows them. Key frames are never held back: the ones with a rotation or a replaced tree, the last
+    // frame of every operation and the steps outside of operations. A step with no changes
+    // since the previous one is dropped. The counters may be read from any thread.
+    template<typename Event>
+    class FrameLimiter {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        // 0 delivers every frame
+        void SetFrameRate(size_t frames_per_second) {
+            period_ = Clock::duration::zero();
+            if (frames_per_second > 0) {
+                period_ = std::chrono::duration_cast<Clock::duration>(std::chrono::seconds(1)) /
+                          static_cast<Clock::rep>(frames_per_second);
+            }
+        }
+
+        // Calls send for every event to deliver
+        template<typename Send>
+        void Filter(const Event& event, Send&& send) {
+            switch (event.type) {
+                case TreeEventType::operation_started:
+                    ++depth_;
+                    break;
+                case TreeEventType::operation_finished:
+                    --depth_;
+                    if (held_step_) {
+                        // It was not merged into anything after all
+                        merged_frames_.fetch_sub(1, std::memory_order_relaxed);
+                        Event step = *std::move(held_step_);
+                        Deliver(step, send);
+                    }
+                    Flush(send);
+                    send(event);
+                    return;
+                case TreeEventType::step:
+                    FilterStep(event, send);
+                    return;
+                case TreeEventType::rotation:
+                case TreeEventType::tree_replaced:
+                    key_frame_ = true;
+                    frame_changed_ = true;
+                    break;
+                default:
+                    frame_changed_ = true;
+                    break;
+            }
+            if (depth_ > 0 && period_ != Clock::duration::zero()) {
+                pending_.push_back(event);
+                return;
+            }
+            send(event);
+        }
+
+        [[nodiscard]] size_t DroppedFrames() const {
+            return dropped_frames_.load(std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] size_t MergedFrames() const {
+            return merged_frames_.load(std::memory_order_relaxed);
+        }
+
+    private:
+        template<typename Send>
+        void FilterStep(const Event& event, Send& send) {
+            if (period_ == Clock::duration::zero()) {
+                Flush(send);
+                send(event);
+                return;
+            }
+            if (depth_ > 0 && !frame_changed_) {
+                dropped_frames_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            frame_changed_ = false;
+            if (depth_ == 0 || key_frame_ || Clock::now() - last_frame_ >= period_) {
+                Deliver(event, send);
+                return;
+            }
+            // A step held before is merged into this one
+            merged_frames_.fetch_add(1, std::memory_order_relaxed);
+            held_step_ = event;
+        }
+
+        template<typename Send>
+        void Deliver(const Event& step, Send& send) {
+            held_step_.reset();
+            key_frame_ = false;
+            last_frame_ = Clock::now();
+            Flush(send);
+            send(step);
+        }
+
+        template<typename Send>
+        void Flush(Send& send) {
+            for (const Event& event : pending_) {
+                send(event);
+            }
+            pending_.clear();
+        }
+
+        Clock::duration period_ = Clock::duration::zero();
+        Clock::time_point last_frame_;
+        size_t depth_ = 0;
+        std::optional<Event> held_step_;
+        std::vector<Event> pending_;
+        bool key_frame_ = false;
+        bool frame_changed_ = false;
+        std::atomic<size_t> dropped_frames_ = 0;
+        std::atomic<size_t> merged_frames_ = 0;
+    };
+
+    // Stand-ins for TreeEventTracer, Observable and FrameLimiter used by an untraced tree
+    struct NullFrameLimiter {};
+
+    struct NullTracer {
+        template<typename NodePtr>
+        NullTracer& SetNodeStatus(NodePtr, Status) {
+            return *this;
+        }
+
+        template<typename NodePtr>
+        NullTracer& Create(NodePtr) {
+            return *this;
+        }
+
+        template<typename NodePtr>
+        NullTracer& Recolor(NodePtr, Color) {
+            return *this;
+        }
+
+        template<typename NodePtr, typename KidPtr>
+        NullTracer& Link(NodePtr, Kid, KidPtr) {
+            return *this;
+        }
+
+        template<typename NodePtr>
+        NullTracer& Rotation(NodePtr, Kid) {
+            return *this;
+        }
+
+        template<typename NodePtr>
+        NullTracer& Destroy(NodePtr) {
+            return *this;
+        }
+
+        void Step() {
+        }
+    };
+
+    struct NullPort {
+        template<typename Tt>
+        explicit NullPort(Tt&&) {
+        }
+
+        void Notify() const {
+        }
+
+        template<typename Tt>
+        void SendByReference(const Tt&) const {
+        }
+    };
+
+    template<typename T, typename Augmentation>
+    struct RedBlackTreeNode {
+        using NodePtr = RedBlackTreeNode*;
+        using ValueType = T;
+
+        // The value is constructed in place from args
+        template<typename... Args>
+        explicit RedBlackTreeNode(NodePtr parent, Color color, Args&&... args)
+            : parent(parent),
+              left(nullptr),
+              right(nullptr),
+              value(std::forward<Args>(args)...),
+              color(color),
+              size(1),
+              aggregate(Augmentation::Lift(value)) {
+        }
+
+        NodePtr GetGrandParent() {
+            if (!parent) {
+                return nullptr;
+            } else {
+                return parent->parent;
+            }
+        }
+
+        NodePtr GetUncle() {
+            if (!parent) {
+                return nullptr;
+            }
+            if (!(parent->parent)) {
+                return nullptr;
+            }
+            return (parent->parent->right == parent ? parent->parent->left : parent->parent->right);
+        }
+
+        Kid WhichKid(NodePtr kid) {
+            if (left == kid) {
+                return Kid::left;
+            } else if (right == kid) {
+                return Kid::right;
+            } else {
+                return Kid::non;
+            }
+        }
+
+        void Print(std::ostream& os, int depth) const {
+            static auto PrintLines = [](std::ostream& os, int32_t depth) {
+                if (depth > 0) {
+                    for (int32_t i = 1; i < depth; ++i) {
+                        os << "|   ";
+                    }
+                    os << "|---";
+                }
+            };
+            PrintLines(os, depth);
+            os << "(" << value << ", " << (color == Color::red ? 'r' : 'b') << ")\n";
+            if (left) {
+                left->Print(os, depth + 1);
+            } else {
+                PrintLines(os, depth + 1);
+                os << "(NIL, b)\n";
+            }
+            if (right) {
+                right->Print(os, depth + 1);
+            } else {
+                PrintLines(os, depth + 1);
+                os << "(NIL, b)\n";
+            }
+        }
+
+        NodePtr parent;
+        NodePtr left;
+        NodePtr right;
+        T value;
+        Color color;
+        // Number of nodes in the subtree of this node
+        size_t size;
+        [[no_unique_address]] typename Augmentation::Value aggregate;
+    };
+
+    template<typename T, typename TracingPolicy = Tracing, typename Allocator = std::allocator<T>,
+             typename Augmentation = NoAugmentation, typename Compare = std::less<T>>
+    class RedBlackTree {
+        using Tracer = std::conditional_t<TracingPolicy::enabled,
+                                          TreeEventTracer<T, Augmentation>, NullTracer>;
+        using Port = std::conditional_t<TracingPolicy::enabled,
+                                        Observable<TreeEvent<RedBlackTreeNode<T, Augmentation>>>,
+                                        NullPort>;
+        using Limiter =
+                std::conditional_t<TracingPolicy::enabled,
+                                   FrameLimiter<TreeEvent<RedBlackTreeNode<T, Augmentation>>>,
+                                   NullFrameLimiter>;
+
+    public:
+        using Node = RedBlackTreeNode<T, Augmentation>;
+        using NodePtr = Node*;
+        using Data = TreeInfo<T, Augmentation>;
+        using Event = TreeEvent<Node>;
+        using ObserverModelViewPtr = Observer<Event>*;
+
+        template<typename Value>
+        class BasicIterator;
+
+        using Iterator = BasicIterator<T>;
+        using ConstIterator = BasicIterator<const T>;
+        using ReverseIterator = std::reverse_iterator<Iterator>;
+        using ConstReverseIterator = std::reverse_iterator<ConstIterator>;
+
+        RedBlackTree() : RedBlackTree(Allocator()) {
+        }
+
+        explicit RedBlackTree(const Allocator& allocator) : RedBlackTree(Compare(), allocator) {
+        }
+
+        explicit RedBlackTree(const Compare& compare, const Allocator& allocator = Allocator())
+            : port_([this]() {
+                  return last_event_;
+              }),
+              node_allocator_(allocator),
+              compare_(compare) {
+            PRINT_WHERE_AM_I();
+        }
+
+        template<typename ForwardIt>
+        RedBlackTree(ForwardIt first, ForwardIt last, const Allocator& allocator = Allocator())
+            : RedBlackTree(allocator) {
+            BuildFromSorted(first, last);
+        }
+
+        RedBlackTree(const RedBlackTree&) = delete;
+        RedBlackTree& operator=(const RedBlackTree&) = delete;
+        RedBlackTree(RedBlackTree&&) = delete;
+        RedBlackTree& operator=(RedBlackTree&&) = delete;
+
+        ~RedBlackTree() {
+            DestroyNodes();
+            SendTree();
+        }
+
+        // The observer gets the last event on subscription and then every new one
+        void SubscribeToEvents(ObserverModelViewPtr observer)
+            requires TracingPolicy::enabled
+        {
+            port_.Subscribe(observer);
+        }
+
+        // Sends at most frames_per_second frames, see FrameLimiter. 0 sends every frame.
+        void SetFrameRate(size_t frames_per_second)
+            requires TracingPolicy::enabled
+        {
+            frame_limiter_.SetFrameRate(frames_per_second);
+        }
+
+        // Frames held back by the frame rate which had no changes
+        [[nodiscard]] size_t DroppedFrames() const
+            requires TracingPolicy::enabled
+        {
+            return frame_limiter_.DroppedFrames();
+        }
+
+        // Frames held back by the frame rate whose changes came with a later frame
+        [[nodiscard]] size_t MergedFrames() const
+            requires TracingPolicy::enabled
+        {
+            return frame_limiter_.MergedFrames();
+        }
+
+        bool Insert(const T& value) {
+            return InsertNode(value, [this, &value](NodePtr parent, Color color) {
+                       return CreateNode(parent, color, value);
+                   })
+                    .second;
+        }
+
+        bool Insert(T&& value) {
+            return InsertNode(value, [this, &value](NodePtr parent, Color color) {
+                       return CreateNode(parent, color, std::move(value));
+                   })
+                    .second;
+        }
+
+        // Inserts value right before hint without a search if it belongs there, otherwise the
+        // same as Insert(value). Returns the iterator to the value. With hint = end() appending
+        // increasing values costs O(1) amortized besides updating the subtree sizes upwards.
+        Iterator Insert(ConstIterator hint, const T& value) {
+            NodePtr hint_node = const_cast<NodePtr>(hint.node_);
+            return Iterator(this, InsertNodeWithHint(hint_node, value,
+                                                     [this, &value](NodePtr parent, Color color) {
+                                                         return CreateNode(parent, color, value);
+                                                     })
+                                          .first);
+        }
+
+        Iterator Insert(ConstIterator hint, T&& value) {
+            NodePtr hint_node = const_cast<NodePtr>(hint.node_);
+            return Iterator(this, InsertNodeWithHint(hint_node, value,
+                                                     [this, &value](NodePtr parent, Color color) {
+                                                         return CreateNode(parent, color,
+                                                                           std::move(value));
+                                                     })
+                                          .first);
+        }
+
+        // Constructs the value in a new node from args. The node is freed if the tree already
+        // has an equivalent value.
+        template<typename... Args>
+        bool Emplace(Args&&... args) {
+            NodePtr new_node = CreateNode(nullptr, Color::red, std::forward<Args>(args)...);
+            bool inserted =
+                    InsertNode(new_node->value, [new_node](NodePtr parent, Color color) {
+                        new_node->parent = parent;
+                        new_node->color = color;
+                        return new_node;
+                    }).second;
+            if (!inserted) {
+                DestroyNode(new_node);
+            }
+            return inserted;
+        }
+
+        bool Erase(const T& value) {
+            return EraseKey(value);
+        }
+
+        template<typename Key>
+            requires TransparentCompare<Compare>
+        bool Erase(const Key& key) {
+            return EraseKey(key);
+        }
+
+        // Erases the value at pos without a search, returns the iterator after it
+        Iterator Erase(ConstIterator pos) {
+            assert(pos.node_);
+            NodePtr node = const_cast<NodePtr>(pos.node_);
+            NodePtr next = NextNode(node);
+            Tracer tracer = MakeTracer();
+            EraseNode(node, tracer);
+            return Iterator(this, next);
+        }
+
+        Iterator Erase(Iterator pos) {
+            return Erase(ConstIterator(pos));
+        }
+
+        // Erases the k values of [first, last) in O(k + log n): the range is cut out with two
+        // splits and one of its nodes is kept as the pivot to join the rest back
+        Iterator Erase(ConstIterator first, ConstIterator last) {
+            NodePtr after = const_cast<NodePtr>(last.node_);
+            if (first == last) {
+                return Iterator(this, after);
+            }
+            if (std::next(first) == last) {
+                return Erase(first);
+            }
+            NodePtr first_node = const_cast<NodePtr>(first.node_);
+            NodePtr before = (first_node == leftmost_ ? nullptr : PrevNode(first_node));
+            NodePtr back = (after ? PrevNode(after) : rightmost_);
+            if (!before && !after) {
+                Clear();
+                return end();
+            }
+            Tracer tracer = MakeTracer();
+            frames_held_ = true;
+            Subtree left{nullptr, 0};
+            Subtree rest{root_, BlackHeight(root_)};
+            if (before) {
+                std::tie(left, rest) = SplitSubtree(rest, before->value, tracer);
+            }
+            auto [middle, right] = SplitSubtree(rest, back->value, tracer);
+            NodePtr pivot = middle.root;
+            size_ -= middle.root->size - 1;
+            SendLeavingSubtree(pivot->left);
+            SendLeavingSubtree(pivot->right);
+            DestroySubtree(pivot->left);
+            DestroySubtree(pivot->right);
+            root_ = JoinSubtrees(left, pivot, right, tracer).root;
+            frames_held_ = false;
+            tracer.Link(nullptr, Kid::non, root_);
+            UpdateBounds();
+            EraseNode(pivot, tracer);
+            return Iterator(this, after);
+        }
+
+        bool Find(const T& value) {
+            return FindKey(value);
+        }
+
+        template<typename Key>
+            requires TransparentCompare<Compare>
+        bool Find(const Key& key) {
+            return FindKey(key);
+        }
+
+        [[nodiscard]] size_t Size() const {
+            return size_;
+        }
+
+        [[nodiscard]] bool Empty() const {
+            return size_ == 0;
+        }
+
+        NodePtr Root() {
+            return root_;
+        }
+
+        const Node* Root() const {
+            return root_;
+        }
+
+        Allocator GetAllocator() const {
+            return Allocator(node_allocator_);
+        }
+
+        const Compare& GetCompare() const {
+            return compare_;
+        }
+
+        // Removes all the values at once. If the allocator can drop its whole arena, no node
+        // is visited at all.
+        void Clear() {
+            DestroyNodes();
+            SendTree();
+        }
+
+        // Replaces the content of the tree with the strictly increasing range [first, last) in
+        // O(n). The tree is perfectly balanced: all the levels are black except the last one,
+        // which is red unless it is full. Subscribers get only the final tree.
+        template<typename ForwardIt>
+        void BuildFromSorted(ForwardIt first, ForwardIt last) {
+            assert(std::adjacent_find(first, last, [this](const T& lhs, const T& rhs) {
+                       return !compare_(lhs, rhs);
+                   }) == last);
+            DestroyNodes();
+            size_t size = std::distance(first, last);
+            size_t full_levels_size = 1;
+            int32_t red_depth = 1;
+            while (full_levels_size * 2 + 1 <= size) {
+                full_levels_size = full_levels_size * 2 + 1;
+                ++red_depth;
+            }
+            if (full_levels_size == size) {
+                red_depth = -1;
+            }
+            root_ = BuildSubtree(first, size, nullptr, 0, red_depth);
+            size_ = size;
+            UpdateBounds();
+            SendTree();
+        }
+
+        // Appends pivot and then all the values of right, which becomes empty. All the values of
+        // the tree must be less than pivot and all the values of right greater than it. Takes
+        // O(log n): right is hung on the spine of the tree at the node of the same black height.
+        // The subscribers are sent the nodes of right, then the fixup step by step.
+        void Join(const T& pivot, RedBlackTree& right) {
+            assert(node_allocator_ == right.node_allocator_);
+            assert(!root_ || compare_(LastNode()->value, pivot));
+            assert(!right.root_ || compare_(pivot, right.FirstNode()->value));
+            Subtree left_subtree{root_, BlackHeight(root_)};
+            Subtree right_subtree{right.root_, BlackHeight(right.root_)};
+            size_ += right.size_ + 1;
+            right.root_ = nullptr;
+            right.size_ = 0;
+            right.UpdateBounds();
+            right.SendTree();
+            Tracer tracer = MakeTracer();
+            NodePtr pivot_node = CreateNode(nullptr, Color::red, pivot);
+            tracer.Create(pivot_node);
+            SendUnlinkedSubtree(right_subtree.root);
+            root_ = JoinSubtrees(left_subtree, pivot_node, right_subtree, tracer).root;
+            UpdateBounds();
+        }
+
+        // The same as Join(pivot, right) into an empty tree that first takes all of left
+        void Join(RedBlackTree& left, const T& pivot, RedBlackTree& right) {
+            assert(Empty());
+            assert(node_allocator_ == left.node_allocator_);
+            std::swap(root_, left.root_);
+            std::swap(size_, left.size_);
+            left.UpdateBounds();
+            left.SendTree();
+            SendTree();
+            Join(pivot, right);
+        }
+
+        // Number of values less than value
+        [[nodiscard]] size_t Rank(const T& value) const {
+            return CountLess(value, false);
+        }
+
+        // The k-th smallest value counting from 0, end() if k >= Size()
+        ConstIterator Select(size_t k) const {
+            NodePtr node = root_;
+            while (node && NodeSize(node->left) != k) {
+                if (k < NodeSize(node->left)) {
+                    node = node->left;
+                } else {
+                    k -= NodeSize(node->left) + 1;
+                    node = node->right;
+                }
+            }
+            return ConstIterator(this, node);
+        }
+
+        // Number of values in [lo, hi]
+        [[nodiscard]] size_t CountInRange(const T& lo, const T& hi) const {
+            if (compare_(hi, lo)) {
+                return 0;
+            }
+            return CountLess(hi, true) - CountLess(lo, false);
+        }
+
+        // Augmentation::Combine folded over the values in [lo, hi] in O(log n), nullopt if there
+        // are none
+        std::optional<typename Augmentation::Value> Aggregate(const T& lo, const T& hi) const
+            requires(!std::is_same_v<Augmentation, NoAugmentation>)
+        {
+            if (compare_(hi, lo)) {
+                return std::nullopt;
+            }
+            return Aggregate(root_, &lo, &hi);
+        }
+
+        // Moves all the values greater than key to right, which must be empty. Takes O(log n):
+        // the tree is cut along the search path of key and the pieces are joined back. The
+        // subscribers are sent the new links and the nodes moved to right as destroyed ones.
+        void Split(const T& key, RedBlackTree& right) {
+            assert(right.Empty());
+            assert(node_allocator_ == right.node_allocator_);
+            {
+                Tracer tracer = MakeTracer();
+                frames_held_ = true;
+                auto [left_subtree, right_subtree] =
+                        SplitSubtree({root_, BlackHeight(root_)}, key, tracer);
+                frames_held_ = false;
+                root_ = left_subtree.root;
+                right.root_ = right_subtree.root;
+                right.size_ = NodeSize(right.root_);
+                size_ -= right.size_;
+                tracer.Link(nullptr, Kid::non, root_);
+                SendLeavingSubtree(right.root_);
+                UpdateBounds();
+            }
+            right.UpdateBounds();
+            right.SendTree();
+        }
+
+        // The first value not less than value
+        Iterator LowerBound(const T& value) {
+            return Iterator(this, LowerBoundNode(value));
+        }
+
+        ConstIterator LowerBound(const T& value) const {
+            return ConstIterator(this, LowerBoundNode(value));
+        }
+
+        template<typename Key>
+            requires TransparentCompare<Compare>
+        Iterator LowerBound(const Key& key) {
+            return Iterator(this, LowerBoundNode(key));
+        }
+
+        template<typename Key>
+            requires TransparentCompare<Compare>
+        ConstIterator LowerBound(const Key& key) const {
+            return ConstIterator(this, LowerBoundNode(key));
+        }
+
+        // The first value greater than value
+        Iterator UpperBound(const T& value) {
+            return Iterator(this, UpperBoundNode(value));
+        }
+
+        ConstIterator UpperBound(const T& value) const {
+            return ConstIterator(this, UpperBoundNode(value));
+        }
+
+        template<typename Key>
+            requires TransparentCompare<Compare>
+        Iterator UpperBound(const Key& key) {
+            return Iterator(this, UpperBoundNode(key));
+        }
+
+        template<typename Key>
+            requires TransparentCompare<Compare>
+        ConstIterator UpperBound(const Key& key) const {
+            return ConstIterator(this, UpperBoundNode(key));
+        }
+
+        // The range of the values equivalent to value, empty or of one value
+        std::pair<Iterator, Iterator> EqualRange(const T& value) {
+            return {LowerBound(value), UpperBound(value)};
+        }
+
+        std::pair<ConstIterator, ConstIterator> EqualRange(const T& value) const {
+            return {LowerBound(value), UpperBound(value)};
+        }
+
+        template<typename Key>
+            requires TransparentCompare<Compare>
+        std::pair<Iterator, Iterator> EqualRange(const Key& key) {
+            return {LowerBound(key), UpperBound(key)};
+        }
+
+        template<typename Key>
+            requires TransparentCompare<Compare>
+        std::pair<ConstIterator, ConstIterator> EqualRange(const Key& key) const {
+            return {LowerBound(key), UpperBound(key)};
+        }
+
+    private:
+        // Links the node returned by make_node(parent, color) unless the tree already has a
+        // value equivalent to value. Returns the node of the value and whether it is new.
+        template<typename MakeNode>
+        std::pair<NodePtr, bool> InsertNode(const T& value, MakeNode make_node) {
+            if (!root_) {
+                Tracer tracer = MakeTracer();
+                root_ = make_node(nullptr, Color::black);
+                leftmost_ = root_;
+                rightmost_ = root_;
+                ++size_;
+                tracer.Create(root_).Link(nullptr, Kid::non, root_);
+                tracer.SetNodeStatus(root_, Status::current).Step();
+                tracer.SetNodeStatus(root_, Status::touched).Step();
+                return {root_, true};
+            }
+            Tracer tracer = MakeTracer();
+            NodePtr parent = SearchNearValue(value, &tracer);
+            if (parent != nullptr && Equivalent(parent->value, value)) {
+                return {parent, false};
+            }
+            Kid side = compare_(value, parent->value) ? Kid::left : Kid::right;
+            return {LinkNode(parent, side, make_node, tracer), true};
+        }
+
+        // The same as InsertNode, but if value belongs right before hint, the node is linked
+        // next to hint without a search
+        template<typename MakeNode>
+        std::pair<NodePtr, bool> InsertNodeWithHint(NodePtr hint, const T& value,
+                                                    MakeNode make_node) {
+            if (!root_) {
+                return InsertNode(value, make_node);
+            }
+            NodePtr prev = hint ? PrevNode(hint) : rightmost_;
+            if ((hint && !compare_(value, hint->value)) ||
+                (prev && !compare_(prev->value, value))) {
+                return InsertNode(value, make_node);
+            }
+            Tracer tracer = MakeTracer();
+            if (hint && !hint->left) {
+                return {LinkNode(hint, Kid::left, make_node, tracer), true};
+            }
+            return {LinkNode(prev, Kid::right, make_node, tracer), true};
+        }
+
+        // Links a new red node as the free kid of parent on the given side
+        template<typename MakeNode>
+        NodePtr LinkNode(NodePtr parent, Kid side, MakeNode make_node, Tracer& tracer) {
+            ++size_;
+            NodePtr node = make_node(parent, Color::red);
+            GetKid(parent, side) = node;
+            tracer.Create(node).Link(parent, side, node);
+            tracer.SetNodeStatus(node, Status::current).Step();
+            if (parent == leftmost_ && side == Kid::left) {
+                leftmost_ = node;
+            } else if (parent == rightmost_ && side == Kid::right) {
+                rightmost_ = node;
+            }
+            UpdatePathToRoot(parent);
+            InsertFixup(node, tracer);
+            return node;
+        }
+
+        template<typename Key>
+        bool EraseKey(const Key& key) {
+            Tracer tracer = MakeTracer();
+            NodePtr node = SearchNearValue(key, &tracer);
+            if (!node || !Equivalent(node->value, key)) {
+                return false;
+            }
+            EraseNode(node, tracer);
+            return true;
+        }
+
+        // The node of a value with two kids trades places with the nearest leaf instead of
+        // taking its value, so values are never copied or moved
+        void EraseNode(NodePtr node, Tracer& tracer) {
+            tracer.SetNodeStatus(node, Status::to_delete).Step();
+            --size_;
+            if (node == leftmost_) {
+                leftmost_ = NextNode(node);
+            }
+            if (node == rightmost_) {
+                rightmost_ = PrevNode(node);
+            }
+            if (NodePtr node_to_delete = GetNearestLeaf(node)) {
+                tracer.SetNodeStatus(node_to_delete, Status::current).Step();
+                SwapWithDescendant(node, node_to_delete, tracer);
+                tracer.SetNodeStatus(node_to_delete, Status::touched).Step();
+            }
+            if (!node->parent) {
+                tracer.Link(nullptr, Kid::non, nullptr).Destroy(node);
+                DestroyNode(node);
+                root_ = nullptr;
+                tracer.Step();
+                return;
+            }
+            Kid kid = node->parent->WhichKid(node);
+            NodePtr ptr = node->right;
+            GetKid(node->parent, kid) = ptr;
+            if (ptr) {
+                ptr->parent = node->parent;
+            }
+            UpdatePathToRoot(node->parent);
+            NodePtr parent = node->parent;
+            Color deleted_color = node->color;
+            tracer.Link(parent, kid, ptr).Destroy(node);
+            DestroyNode(node);
+            if (deleted_color == Color::red) {
+                tracer.Step();
+                return;
+            }
+            node = ptr;
+            tracer.SetNodeStatus(node, Status::current).Step();
+            while (parent) {
+                kid = parent->WhichKid(node);
+                NodePtr sibling = GetKid(parent, Opposite(kid));
+                if (sibling->color == Color::red) {
+                    SetColor(parent, Color::red, tracer);
+                    SetColor(sibling, Color::black, tracer);
+                    Rotate(sibling, kid);
+                    sibling = GetKid(parent, Opposite(kid));
+                    tracer.Step();
+                }
+                if (GetNodeColor(sibling->left) == Color::black &&
+                    GetNodeColor(sibling->right) == Color::black) {
+                    if (parent->color == Color::black) {
+                        SetColor(sibling, Color::red, tracer);
+                        node = parent;
+                        parent = node->parent;
+                        tracer.SetNodeStatus(node, Status::current).Step();
+                        continue;
+                    } else {
+                        SetColor(parent, Color::black, tracer);
+                        SetColor(sibling, Color::red, tracer);
+                        tracer.Step();
+                        return;
+                    }
+                }
+                if (GetNodeColor(GetKid(sibling, kid)) == Color::red &&
+                    GetNodeColor(GetKid(sibling, Opposite(kid))) == Color::black) {
+                    Rotate(GetKid(sibling, kid), Opposite(kid));
+                    tracer.Step();
+                    SetColor(sibling, Color::red, tracer);
+                    SetColor(sibling->parent, Color::black, tracer);
+                    sibling = sibling->parent;
+                    tracer.Step();
+                }
+                Color color = parent->color;
+                Rotate(sibling, kid);
+                tracer.Step();
+                SetColor(parent, Color::black, tracer);
+                SetColor(GetKid(sibling, Opposite(kid)), Color::black, tracer);
+                SetColor(parent->parent, color, tracer);
+                tracer.Step();
+                return;
+            }
+        }
+
+        template<typename Key>
+        bool FindKey(const Key& key) {
+            Tracer tracer = MakeTracer();
+            auto result = SearchNearValue(key, &tracer);
+            if (result != nullptr && Equivalent(result->value, key)) {
+                tracer.SetNodeStatus(result, Status::found).Step();
+                return true;
+            } else {
+                return false;
+            }
+        }
+
+        template<typename Lhs, typename Rhs>
+        bool Equivalent(const Lhs& lhs, const Rhs& rhs) const {
+            return !compare_(lhs, rhs) && !compare_(rhs, lhs);
+        }
+
+        // Exchanges the places of node and its descendant in the tree, the values stay in their
+        // nodes
+        void SwapWithDescendant(NodePtr node, NodePtr descendant, Tracer& tracer) {
+            NodePtr parent = node->parent;
+            Kid kid = parent ? parent->WhichKid(node) : Kid::non;
+            NodePtr descendant_parent = descendant->parent;
+            Kid descendant_kid = descendant_parent->WhichKid(descendant);
+            std::swap(node->left, descendant->left);
+            std::swap(node->right, descendant->right);
+            std::swap(node->color, descendant->color);
+            std::swap(node->size, descendant->size);
+            if (descendant_parent == node) {
+                descendant_parent = descendant;
+            }
+            GetKid(descendant_parent, descendant_kid) = node;
+            node->parent = descendant_parent;
+            descendant->parent = parent;
+            if (parent) {
+                GetKid(parent, kid) = descendant;
+            } else {
+                root_ = descendant;
+            }
+            for (NodePtr swapped : {node, descendant}) {
+                for (NodePtr swapped_kid : {swapped->left, swapped->right}) {
+                    if (swapped_kid) {
+                        swapped_kid->parent = swapped;
+                    }
+                }
+            }
+            tracer.Link(parent, kid, descendant).Link(descendant_parent, descendant_kid, node);
+            for (NodePtr swapped : {node, descendant}) {
+                tracer.Link(swapped, Kid::left, swapped->left)
+                        .Link(swapped, Kid::right, swapped->right)
+                        .Recolor(swapped, swapped->color);
+            }
+        }
+
+        static void SetColor(NodePtr node, Color color, Tracer& tracer) {
+            node->color = color;
+            tracer.Recolor(node, color);
+        }
+
+        template<typename... Args>
+        NodePtr CreateNode(NodePtr parent, Color color, Args&&... args) {
+            NodePtr node = NodeAllocatorTraits::allocate(node_allocator_, 1);
+            NodeAllocatorTraits::construct(node_allocator_, node, parent, color,
+                                           std::forward<Args>(args)...);
+            return node;
+        }
+
+        void DestroyNode(NodePtr node) {
+            NodeAllocatorTraits::destroy(node_allocator_, node);
+            NodeAllocatorTraits::deallocate(node_allocator_, node, 1);
+        }
+
+        template<typename ForwardIt>
+        NodePtr BuildSubtree(ForwardIt& it, size_t size, NodePtr parent, int32_t depth,
+                             int32_t red_depth) {
+            if (size == 0) {
+                return nullptr;
+            }
+            size_t left_size = (size - 1) / 2;
+            NodePtr left = BuildSubtree(it, left_size, nullptr, depth + 1, red_depth);
+            NodePtr node =
+                    CreateNode(parent, depth == red_depth ? Color::red : Color::black, *it);
+            ++it;
+            node->left = left;
+            if (left) {
+                left->parent = node;
+            }
+            node->right = BuildSubtree(it, size - 1 - left_size, node, depth + 1, red_depth);
+            UpdateNode(node);
+            return node;
+        }
+
+        template<typename Key>
+        NodePtr LowerBoundNode(const Key& key) const {
+            NodePtr result = nullptr;
+            for (NodePtr node = root_; node;) {
+                if (compare_(node->value, key)) {
+                    node = node->right;
+                } else {
+                    result = node;
+                    node = node->left;
+                }
+            }
+            return result;
+        }
+
+        template<typename Key>
+        NodePtr UpperBoundNode(const Key& key) const {
+            NodePtr result = nullptr;
+            for (NodePtr node = root_; node;) {
+                if (compare_(key, node->value)) {
+                    result = node;
+                    node = node->left;
+                } else {
+                    node = node->right;
+                }
+            }
+            return result;
+        }
+
+        // Finds the cached first and last nodes anew after the tree was rebuilt
+        void UpdateBounds() {
+            leftmost_ = FirstNode();
+            rightmost_ = LastNode();
+        }
+
+        // Number of values less than value, or not greater than value if or_equal is set
+        size_t CountLess(const T& value, bool or_equal) const {
+            size_t result = 0;
+            NodePtr node = root_;
+            while (node) {
+                if (compare_(value, node->value) || (!or_equal && !compare_(node->value, value))) {
+                    node = node->left;
+                } else {
+                    result += NodeSize(node->left) + 1;
+                    node = node->right;
+                }
+            }
+            return result;
+        }
 
-    template<typename T>
-    class TreeInfoWrapper;
+        // Aggregate over the values of the subtree of node in [*lo, *hi], a null bound is open
+        std::optional<typename Augmentation::Value> Aggregate(NodePtr node, const T* lo,
+                                                             const T* hi) const {
+            while (node &&
+                   ((lo && compare_(node->value, *lo)) || (hi && compare_(*hi, node->value)))) {
+                node = (lo && compare_(node->value, *lo)) ? node->right : node->left;
+            }
+            if (!node) {
+                return std::nullopt;
+            }
+            if (!lo && !hi) {
+                return node->aggregate;
+            }
+            typename Augmentation::Value result = Augmentation::Lift(node->value);
+            if (auto left = Aggregate(node->left, lo, nullptr)) {
+                result = Augmentation::Combine(*left, result);
+            }
+            if (auto right = Aggregate(node->right, nullptr, hi)) {
+                result = Augmentation::Combine(result, *right);
+            }
+            return result;
+        }
 
-    template<typename T>
-    class RedBlackTree {
-    public:
-        struct Node;
-        using NodePtr = Node*;
-        using Data = TreeInfo<T>;
-        using ObserverModelViewPtr = Observer<Data>*;
+        struct Subtree {
+            NodePtr root;
+            int32_t black_height;
+        };
 
-        RedBlackTree()
-            : port_([]() {
-                  return TreeInfo<T>{0, nullptr, {}};
-              }) {
-            PRINT_WHERE_AM_I();
+        // Number of black nodes on any path from node down to NIL, NIL excluded
+        static int32_t BlackHeight(NodePtr node) {
+            int32_t black_height = 0;
+            for (; node; node = node->left) {
+                black_height += (node->color == Color::black);
+            }
+            return black_height;
         }
 
-        ~RedBlackTree() {
-            port_.SendByReference({});
+        static size_t NodeSize(NodePtr node) {
+            return node ? node->size : 0;
         }
 
-        void SubscribeToData(ObserverModelViewPtr observer) {
-            port_.Subscribe(observer);
+        // Recomputes the size and the aggregate of node from its kids
+        static void UpdateNode(NodePtr node) {
+            node->size = NodeSize(node->left) + NodeSize(node->right) + 1;
+            if constexpr (!std::is_same_v<Augmentation, NoAugmentation>) {
+                typename Augmentation::Value aggregate = Augmentation::Lift(node->value);
+                if (node->left) {
+                    aggregate = Augmentation::Combine(node->left->aggregate, aggregate);
+                }
+                if (node->right) {
+                    aggregate = Augmentation::Combine(aggregate, node->right->aggregate);
+                }
+                node->aggregate = std::move(aggregate);
+            }
         }
 
-        bool Insert(const T& value) {
-            if (!root_) {
-                root_ = std::unique_ptr<Node>(
-                        new Node{nullptr, nullptr, nullptr, value, Color::black});
-                ++size_;
-                TreeInfoWrapper<T> tree_info_wrapper({size_, root_.get(), {}},
-                                                  [this](TreeInfo<T> tree_info) {
-                                                      port_.SendByValue(std::move(tree_info));
-                                                  });
-                port_.SendByReference(
-                        tree_info_wrapper.SetNodeStatus(root_.get(), Status::current));
-                port_.SendByReference(
-                        tree_info_wrapper.SetNodeStatus(root_.get(), Status::touched));
-                return true;
+        // Updates the nodes on the path from node to the root
+        static void UpdatePathToRoot(NodePtr node) {
+            for (; node; node = node->parent) {
+                UpdateNode(node);
             }
-            TreeInfoWrapper<T> tree_info_wrapper({size_, root_.get(), {}},
-                                              [this](TreeInfo<T> tree_info) {
-                                                  port_.SendByValue(std::move(tree_info));
-                                              });
-            NodePtr parent = SearchNearValue(value, static_cast<TreeInfo<T>*>(&tree_info_wrapper));
-            if (parent != nullptr && parent->value == value) {
-                return false;
+        }
+
+        // Makes the kid of a node the root of a separate black-rooted subtree
+        static Subtree DetachKid(NodePtr kid, int32_t black_height, Tracer& tracer) {
+            if (kid) {
+                kid->parent = nullptr;
+                if (kid->color == Color::red) {
+                    SetColor(kid, Color::black, tracer);
+                    ++black_height;
+                }
             }
-            ++size_;
-            auto node = new Node{parent, nullptr, nullptr, value, Color::red};
-            port_.SendByReference(tree_info_wrapper.SetNodeStatus(node, Status::current));
-            (value < parent->value ? parent->left : parent->right) = std::unique_ptr<Node>(node);
-            while (GetNodeColor(parent) == Color::black ||
-                   GetNodeColor(node->GetUncle()) == Color::red) {
-                if (GetNodeColor(parent) == Color::black) {
-                    if (!parent) {
-                        node->color = Color::black;
+            return {kid, black_height};
+        }
+
+        // Joins two black-rooted subtrees with values less and greater than pivot. The
+        // subscribers must know all their nodes, the new links are reported before the fixup.
+        Subtree JoinSubtrees(Subtree left, NodePtr pivot, Subtree right, Tracer& tracer) {
+            pivot->parent = nullptr;
+            pivot->left = left.root;
+            pivot->right = right.root;
+            if (left.black_height == right.black_height) {
+                SetColor(pivot, Color::black, tracer);
+                for (NodePtr kid : {left.root, right.root}) {
+                    if (kid) {
+                        kid->parent = pivot;
                     }
-                    tree_info_wrapper.root = Root();
-                    port_.SendByReference(tree_info_wrapper.SetNodeStatus(node, Status::touched));
-                    return true;
-                } else {
-                    node->GetUncle()->color = Color::black;
-                    node->parent->color = Color::black;
-                    node->GetGrandParent()->color = Color::red;
-                    tree_info_wrapper.SetNodeStatus(node, Status::touched);
-                    node = node->GetGrandParent();
-                    port_.SendByReference(tree_info_wrapper.SetNodeStatus(node, Status::current));
-                    parent = node->parent;
                 }
+                UpdateNode(pivot);
+                tracer.Link(nullptr, Kid::non, pivot)
+                        .Link(pivot, Kid::left, left.root)
+                        .Link(pivot, Kid::right, right.root);
+                return {pivot, left.black_height + 1};
             }
-            Kid parent_grandparent = node->GetGrandParent()->WhichKid(node->parent);
-            Kid node_parent = node->parent->WhichKid(node);
-            if (node_parent == Opposite(parent_grandparent)) {
-                Rotate(node, parent_grandparent);
-                tree_info_wrapper.root = Root();
-                port_.SendByReference(tree_info_wrapper);
-                tree_info_wrapper.SetNodeStatus(node, Status::touched);
-                node = GetKid(node, parent_grandparent).get();
-                port_.SendByReference(tree_info_wrapper.SetNodeStatus(node, Status::current));
+            Kid side = (left.black_height > right.black_height ? Kid::right : Kid::left);
+            Subtree& higher = (side == Kid::right ? left : right);
+            Subtree& lower = (side == Kid::right ? right : left);
+            NodePtr parent = nullptr;
+            NodePtr node = higher.root;
+            int32_t black_height = higher.black_height;
+            while (node && (black_height > lower.black_height || node->color == Color::red)) {
+                black_height -= (node->color == Color::black);
+                parent = node;
+                node = GetKid(node, side);
             }
-            Rotate(node->parent, Opposite(parent_grandparent));
-            tree_info_wrapper.root = Root();
-            port_.SendByReference(tree_info_wrapper);
-            node->parent->color = Color::black;
-            GetKid(node->parent, Opposite(parent_grandparent))->color = Color::red;
-            if (!node->GetGrandParent()) {
-                tree_info_wrapper.root = Root();
-            }
-            port_.SendByReference(tree_info_wrapper.SetNodeStatus(node, Status::touched));
-            return true;
+            SetColor(pivot, Color::red, tracer);
+            pivot->parent = parent;
+            GetKid(parent, side) = pivot;
+            GetKid(pivot, Opposite(side)) = node;
+            GetKid(pivot, side) = lower.root;
+            for (NodePtr kid : {node, lower.root}) {
+                if (kid) {
+                    kid->parent = pivot;
+                }
+            }
+            UpdatePathToRoot(pivot);
+            root_ = higher.root;
+            tracer.Link(nullptr, Kid::non, higher.root)
+                    .Link(parent, side, pivot)
+                    .Link(pivot, Opposite(side), node)
+                    .Link(pivot, side, lower.root);
+            tracer.SetNodeStatus(pivot, Status::current).Step();
+            bool grew = InsertFixup(pivot, tracer);
+            return {UpdateRoot(pivot), higher.black_height + grew};
         }
 
-        bool Erase(const T& value) {
-            TreeInfoWrapper<T> tree_info_wrapper({size_, root_.get(), {}},
-                                              [this](TreeInfo<T> tree_info) {
-                                                  port_.SendByValue(std::move(tree_info));
-                                              });
-            NodePtr node = SearchNearValue(value, &tree_info_wrapper.GetTreeInfo());
-            if (!node || node->value != value) {
-                return false;
-            }
-            port_.SendByReference(tree_info_wrapper.SetNodeStatus(node, Status::to_delete));
-            --size_;
-            if (NodePtr node_to_delete = GetNearestLeaf(node)) {
-                port_.SendByReference(
-                        tree_info_wrapper.SetNodeStatus(node_to_delete, Status::current));
-                tree_info_wrapper.SetNodeStatus(node_to_delete, Status::to_delete);
-                port_.SendByReference(tree_info_wrapper.SetNodeStatus(node, Status::current));
-                node->value = node_to_delete->value;
-                port_.SendByReference(tree_info_wrapper.SetNodeStatus(node, Status::touched));
-                node = node_to_delete;
+        std::pair<Subtree, Subtree> SplitSubtree(Subtree subtree, const T& key, Tracer& tracer) {
+            NodePtr node = subtree.root;
+            if (!node) {
+                return {{nullptr, 0}, {nullptr, 0}};
             }
-            if (!node->parent) {
-                root_ = nullptr;
-                tree_info_wrapper.root = nullptr;
-                port_.SendByReference(tree_info_wrapper);
-                return true;
+            int32_t kid_black_height = subtree.black_height - (node->color == Color::black);
+            Subtree left = DetachKid(node->left, kid_black_height, tracer);
+            Subtree right = DetachKid(node->right, kid_black_height, tracer);
+            if (compare_(key, node->value)) {
+                auto [less, greater] = SplitSubtree(left, key, tracer);
+                return {less, JoinSubtrees(greater, node, right, tracer)};
             }
-            Kid kid = node->parent->WhichKid(node);
-            auto ptr = node->right.release();
-            GetKid(node->parent, kid).release();
-            GetKid(node->parent, kid).reset(ptr);
-            if (ptr) {
-                ptr->parent = node->parent;
+            auto [less, greater] = SplitSubtree(right, key, tracer);
+            return {JoinSubtrees(left, node, less, tracer), greater};
+        }
+
+        void DestroyNodes() {
+            NodePtr node = root_;
+            root_ = nullptr;
+            leftmost_ = nullptr;
+            rightmost_ = nullptr;
+            size_ = 0;
+            // The aggregate of an augmentation is destroyed with the node as well
+            if constexpr (std::is_trivially_destructible_v<Node> &&
+                          requires(NodeAllocator& allocator) { allocator.ReleaseIfUnique(); }) {
+                if (node_allocator_.ReleaseIfUnique()) {
+                    return;
+                }
             }
-            std::unique_ptr<Node> tmp(node);
-            if (node->color == Color::red) {
-                port_.SendByReference(tree_info_wrapper);
-                return true;
+            DestroySubtree(node);
+        }
+
+        // Frees the nodes of the subtree of node without recursion
+        void DestroySubtree(NodePtr node) {
+            if (node) {
+                node->parent = nullptr;
             }
-            NodePtr parent = node->parent;
-            node = ptr;
-            port_.SendByReference(tree_info_wrapper.SetNodeStatus(node, Status::current));
-            while (parent) {
-                kid = parent->WhichKid(node);
-                NodePtr sibling = GetKid(parent, Opposite(kid)).get();
-                if (sibling->color == Color::red) {
-                    parent->color = Color::red;
-                    sibling->color = Color::black;
-                    Rotate(sibling, kid);
-                    sibling = GetKid(parent, Opposite(kid)).get();
-                    tree_info_wrapper.root = Root();
-                    port_.SendByReference(tree_info_wrapper);
-                }
-                if (GetNodeColor(sibling->left.get()) == Color::black &&
-                    GetNodeColor(sibling->right.get()) == Color::black) {
-                    if (parent->color == Color::black) {
-                        sibling->color = Color::red;
-                        node = parent;
-                        parent = node->parent;
-                        port_.SendByReference(
-                                tree_info_wrapper.SetNodeStatus(node, Status::current));
-                        continue;
-                    } else {
-                        parent->color = Color::black;
-                        sibling->color = Color::red;
-                        port_.SendByReference(tree_info_wrapper);
-                        return true;
+            while (node) {
+                if (node->left) {
+                    node = node->left;
+                } else if (node->right) {
+                    node = node->right;
+                } else {
+                    NodePtr parent = node->parent;
+                    if (parent) {
+                        GetKid(parent, parent->WhichKid(node)) = nullptr;
                     }
+                    DestroyNode(node);
+                    node = parent;
                 }
-                if (GetNodeColor(GetKid(sibling, kid).get()) == Color::red &&
-                    GetNodeColor(GetKid(sibling, Opposite(kid)).get()) == Color::black) {
-                    Rotate(GetKid(sibling, kid).get(), Opposite(kid));
-                    tree_info_wrapper.root = Root();
-                    port_.SendByReference(tree_info_wrapper);
-                    sibling->color = Color::red;
-                    sibling->parent->color = Color::black;
-                    sibling = sibling->parent;
-                    port_.SendByReference(tree_info_wrapper);
+            }
+        }
+
+        // Sends the current tree without any statuses, O(n)
+        void SendTree() {
+            if constexpr (TracingPolicy::enabled) {
+                SendEvent(Event::TreeReplaced(root_, size_));
+                SendSubtree(nullptr, Kid::non, root_);
+                SendEvent(Event::Step(size_));
+            }
+        }
+
+        void SendSubtree(NodePtr parent, Kid side, NodePtr node) {
+            if (!node) {
+                return;
+            }
+            SendEvent(Event::NodeCreated(node, node->value, node->color));
+            SendEvent(Event::LinkChanged(parent, side, node));
+            SendSubtree(node, Kid::left, node->left);
+            SendSubtree(node, Kid::right, node->right);
+        }
+
+        // Sends the nodes of a subtree the subscribers haven't seen, the link to its root comes
+        // later
+        void SendUnlinkedSubtree(NodePtr root) {
+            if constexpr (TracingPolicy::enabled) {
+                if (root) {
+                    SendEvent(Event::NodeCreated(root, root->value, root->color));
+                    SendSubtree(root, Kid::left, root->left);
+                    SendSubtree(root, Kid::right, root->right);
                 }
-                Color color = parent->color;
-                Rotate(sibling, kid);
-                tree_info_wrapper.root = Root();
-                port_.SendByReference(tree_info_wrapper);
-                parent->color = Color::black;
-                GetKid(sibling, Opposite(kid))->color = Color::black;
-                parent->parent->color = color;
-                tree_info_wrapper.root = root_.get();
-                port_.SendByReference(tree_info_wrapper);
-                return true;
             }
-            return true;
         }
 
-        bool Find(const T& value) {
-            TreeInfoWrapper<T> tree_info_wrapper({size_, root_.get(), {}},
-                                              [this](TreeInfo<T> tree_info) {
-                                                  port_.SendByValue(std::move(tree_info));
-                                              });
-            auto result = SearchNearValue(value, &tree_info_wrapper.GetTreeInfo());
-            if (result != nullptr && result->value == value) {
-                port_.SendByReference(tree_info_wrapper.SetNodeStatus(result, Status::found));
-                return true;
-            } else {
-                return false;
+        // Sends the nodes of a subtree which leaves the tree as destroyed ones
+        void SendLeavingSubtree(NodePtr node) {
+            if constexpr (TracingPolicy::enabled) {
+                if (node) {
+                    SendLeavingSubtree(node->left);
+                    SendLeavingSubtree(node->right);
+                    SendEvent(Event::NodeDestroyed(node));
+                }
             }
         }
 
-        [[nodiscard]] size_t Size() const {
-            return size_;
+        // The event is kept in the tree, so the observers get it by reference and a new
+        // observer gets the last one on subscription
+        void SendEvent(const Event& event) {
+            if (frames_held_ && event.type == TreeEventType::step) {
+                return;
+            }
+            frame_limiter_.Filter(event, [this](const Event& passed) {
+                last_event_ = passed;
+                port_.SendByReference(last_event_);
+            });
         }
 
-        [[nodiscard]] bool Empty() const {
-            return size_ == 0;
+        Tracer MakeTracer() {
+            if constexpr (TracingPolicy::enabled) {
+                return Tracer(
+                        [this](const Event& event) {
+                            SendEvent(event);
+                        },
+                        root_, &size_);
+            } else {
+                return {};
+            }
         }
 
-        NodePtr Root() {
-            return root_.get();
+        NodePtr LastNode() const {
+            if (!root_) {
+                return nullptr;
+            }
+            NodePtr node = root_;
+            while (node->right) {
+                node = node->right;
+            }
+            return node;
         }
 
-    private:
         NodePtr FirstNode() const {
             if (!root_) {
                 return nullptr;
             }
-            NodePtr node = root_.get();
+            NodePtr node = root_;
             while (node->left) {
-                node = node->left.get();
+                node = node->left;
             }
             return node;
         }
@@ -259,7 +1469,7 @@ namespace DSVisualization {
             }
         }
 
-        std::unique_ptr<Node>& GetKid(NodePtr node, Kid direction) {
+        NodePtr& GetKid(NodePtr node, Kid direction) {
             if (direction == Kid::left) {
                 return node->left;
             } else {
@@ -267,7 +1477,7 @@ namespace DSVisualization {
             }
         }
 
-        void Rotate(typename RedBlackTree<T>::Node* node, Kid direction) {
+        void Rotate(NodePtr node, Kid direction) {
             if (direction == Kid::left) {
                 RotateLeft(node);
             } else {
@@ -284,47 +1494,38 @@ namespace DSVisualization {
                   ---|---              ---|---
                   c     e              a     c
          */
-        void RotateLeft(typename RedBlackTree<T>::Node* d) {
+        void RotateLeft(NodePtr d) {
             PRINT_WHERE_AM_I();
-            TreeInfoWrapper<T> tree_info_wrapper({size_, root_.get(), {}},
-                                              [this](TreeInfo<T> tree_info) {
-                                                  port_.SendByValue(std::move(tree_info));
-                                              });
-            auto current_tree_info = GetTreeInfo(*this);
+            Tracer tracer = MakeTracer();
             NodePtr b = d->parent;
-            NodePtr c = d->left.get();
+            NodePtr c = d->left;
             NodePtr pp = b->parent;
             Kid kid = Kid::non;
             if (pp) {
                 kid = pp->WhichKid(b);
             }
-            port_.SendByReference(tree_info_wrapper.SetNodeStatus(b, Status::rotate)
-                                          .SetNodeStatus(b->left.get(), Status::rotate)
-                                          .SetNodeStatus(d, Status::rotate)
-                                          .SetNodeStatus(d->left.get(), Status::rotate)
-                                          .SetNodeStatus(d->right.get(), Status::rotate));
-            NodePtr old_root = root_.release();
-            d->left.release();
-            b->right.release();
+            tracer.SetNodeStatus(b, Status::rotate)
+                    .SetNodeStatus(b->left, Status::rotate)
+                    .SetNodeStatus(d, Status::rotate)
+                    .SetNodeStatus(d->left, Status::rotate)
+                    .SetNodeStatus(d->right, Status::rotate)
+                    .Step();
             b->parent = d;
-            b->right.reset(c);
+            b->right = c;
             if (c) {
                 c->parent = b;
             }
-            d->left.reset(b);
+            d->left = b;
             d->parent = pp;
             if (pp) {
-                if (kid == Kid::left) {
-                    pp->left.release();
-                    pp->left.reset(d);
-                } else {
-                    pp->right.release();
-                    pp->right.reset(d);
-                }
+                GetKid(pp, kid) = d;
             }
-            root_.reset(UpdateRoot(old_root));
-            tree_info_wrapper.root = root_.get();
-            port_.SendByReference(tree_info_wrapper);
+            UpdateNode(b);
+            UpdateNode(d);
+            root_ = UpdateRoot(root_);
+            tracer.Rotation(d, Kid::left).Link(b, Kid::right, c).Link(d, Kid::left, b);
+            LinkAboveRotated(d, pp, kid, tracer);
+            tracer.Step();
         }
 
         /*
@@ -336,68 +1537,109 @@ namespace DSVisualization {
         ---|---                                          ---|---
         a     c                                          c     e
          */
-        void RotateRight(typename RedBlackTree<T>::Node* b) {
+        void RotateRight(NodePtr b) {
             PRINT_WHERE_AM_I();
-            TreeInfoWrapper<T> tree_info_wrapper({size_, root_.get(), {}},
-                                              [this](TreeInfo<T> tree_info) {
-                                                  port_.SendByValue(std::move(tree_info));
-                                              });
-            auto current_tree_info = GetTreeInfo(*this);
+            Tracer tracer = MakeTracer();
             NodePtr d = b->parent;
-            NodePtr c = b->right.get();
+            NodePtr c = b->right;
             NodePtr pp = d->parent;
             Kid kid = Kid::non;
             if (pp) {
                 kid = pp->WhichKid(d);
             }
-            port_.SendByReference(tree_info_wrapper.SetNodeStatus(d, Status::rotate)
-                                          .SetNodeStatus(b, Status::rotate)
-                                          .SetNodeStatus(b->left.get(), Status::rotate)
-                                          .SetNodeStatus(b->right.get(), Status::rotate)
-                                          .SetNodeStatus(d->right.get(), Status::rotate));
-            NodePtr old_root = root_.release();
-            d->left.release();
-            b->right.release();
+            tracer.SetNodeStatus(d, Status::rotate)
+                    .SetNodeStatus(b, Status::rotate)
+                    .SetNodeStatus(b->left, Status::rotate)
+                    .SetNodeStatus(b->right, Status::rotate)
+                    .SetNodeStatus(d->right, Status::rotate)
+                    .Step();
             d->parent = b;
-            d->left.reset(c);
+            d->left = c;
             if (c) {
                 c->parent = d;
             }
-            b->right.reset(d);
+            b->right = d;
             b->parent = pp;
             if (pp) {
-                if (kid == Kid::left) {
-                    pp->left.release();
-                    pp->left.reset(b);
+                GetKid(pp, kid) = b;
+            }
+            UpdateNode(d);
+            UpdateNode(b);
+            root_ = UpdateRoot(root_);
+            tracer.Rotation(b, Kid::right).Link(d, Kid::left, c).Link(b, Kid::right, d);
+            LinkAboveRotated(b, pp, kid, tracer);
+            tracer.Step();
+        }
+
+        // Reports the link to the node which went up in a rotation. A rotation at the root of a
+        // subtree which is not in the tree yet (while joining) is not reported.
+        void LinkAboveRotated(NodePtr node, NodePtr pp, Kid kid, Tracer& tracer) {
+            if (pp) {
+                tracer.Link(pp, kid, node);
+            } else if (node == root_) {
+                tracer.Link(nullptr, Kid::non, node);
+            }
+        }
+
+        // Restores the invariants after the red node was linked under its parent. Returns true
+        // if the red reached the root, so the black height of the tree grew.
+        bool InsertFixup(NodePtr node, Tracer& tracer) {
+            NodePtr parent = node->parent;
+            while (GetNodeColor(parent) == Color::black ||
+                   GetNodeColor(node->GetUncle()) == Color::red) {
+                if (GetNodeColor(parent) == Color::black) {
+                    if (!parent) {
+                        SetColor(node, Color::black, tracer);
+                    }
+                    tracer.SetNodeStatus(node, Status::touched).Step();
+                    return !parent;
                 } else {
-                    pp->right.release();
-                    pp->right.reset(b);
+                    SetColor(node->GetUncle(), Color::black, tracer);
+                    SetColor(node->parent, Color::black, tracer);
+                    SetColor(node->GetGrandParent(), Color::red, tracer);
+                    tracer.SetNodeStatus(node, Status::touched);
+                    node = node->GetGrandParent();
+                    tracer.SetNodeStatus(node, Status::current).Step();
+                    parent = node->parent;
                 }
             }
-            root_.reset(UpdateRoot(old_root));
-            tree_info_wrapper.root = root_.get();
-            port_.SendByReference(tree_info_wrapper);
+            Kid parent_grandparent = node->GetGrandParent()->WhichKid(node->parent);
+            Kid node_parent = node->parent->WhichKid(node);
+            if (node_parent == Opposite(parent_grandparent)) {
+                Rotate(node, parent_grandparent);
+                tracer.Step();
+                tracer.SetNodeStatus(node, Status::touched);
+                node = GetKid(node, parent_grandparent);
+                tracer.SetNodeStatus(node, Status::current).Step();
+            }
+            Rotate(node->parent, Opposite(parent_grandparent));
+            tracer.Step();
+            SetColor(node->parent, Color::black, tracer);
+            SetColor(GetKid(node->parent, Opposite(parent_grandparent)), Color::red, tracer);
+            tracer.SetNodeStatus(node, Status::touched).Step();
+            return false;
         }
 
-        NodePtr SearchNearValue(const T& value, TreeInfo<T>* tree_info) {
-            NodePtr node = root_.get();
-            port_.SendByReference(tree_info->SetNodeStatus(node, Status::current));
+        template<typename Key>
+        NodePtr SearchNearValue(const Key& value, Tracer* tracer) {
+            NodePtr node = root_;
+            tracer->SetNodeStatus(node, Status::current).Step();
             while (node) {
-                tree_info->SetNodeStatus(node, Status::touched);
-                if (value < node->value) {
+                tracer->SetNodeStatus(node, Status::touched);
+                if (compare_(value, node->value)) {
                     if (!node->left) {
                         break;
                     }
-                    node = node->left.get();
-                } else if (value == node->value) {
+                    node = node->left;
+                } else if (!compare_(node->value, value)) {
                     break;
                 } else {
                     if (!node->right) {
                         break;
                     }
-                    node = node->right.get();
+                    node = node->right;
                 }
-                port_.SendByReference(tree_info->SetNodeStatus(node, Status::current));
+                tracer->SetNodeStatus(node, Status::current).Step();
             }
             return node;
         }
@@ -405,13 +1647,16 @@ namespace DSVisualization {
     public:
 #ifdef INVARIANTS_CHECK
         [[nodiscard]] bool CheckInvariants() const {
+            if (leftmost_ != FirstNode() || rightmost_ != LastNode()) {
+                return false;
+            }
             std::vector<T> values;
             std::vector<int32_t> depths;
-            if (!CheckInvariants(root_.get(), &values, &depths, 0)) {
+            if (!CheckInvariants(root_, &values, &depths, 0)) {
                 return false;
             }
             for (size_t i = 0; i + 1 < values.size(); ++i) {
-                if (values[i] > values[i + 1]) {
+                if (compare_(values[i + 1], values[i])) {
                     return false;
                 }
             }
@@ -420,112 +1665,108 @@ namespace DSVisualization {
         }
 #endif
 
-        struct Node {
-            NodePtr GetGrandParent() {
-                if (!parent) {
-                    return nullptr;
-                } else {
-                    return parent->parent;
-                }
-            }
+        // Bidirectional iterator over the values in order, Value is T or const T. Decrementing
+        // end() gives the last value.
+        template<typename Value>
+        class BasicIterator {
+            using NodePointer = std::conditional_t<std::is_const_v<Value>, const Node*, NodePtr>;
 
-            NodePtr GetUncle() {
-                if (!parent) {
-                    return nullptr;
-                }
-                if (!(parent->parent)) {
-                    return nullptr;
-                }
-                return (parent->parent->right.get() == parent ? parent->parent->left.get()
-                                                              : parent->parent->right.get());
-            }
+        public:
+            using iterator_category = std::bidirectional_iterator_tag;
+            using value_type = std::remove_const_t<Value>;
+            using difference_type = std::ptrdiff_t;
+            using pointer = Value*;
+            using reference = Value&;
 
-            Kid WhichKid(NodePtr kid) {
-                if (left.get() == kid) {
-                    return Kid::left;
-                } else if (right.get() == kid) {
-                    return Kid::right;
-                } else {
-                    return Kid::non;
-                }
-            }
+            BasicIterator() = default;
 
-            void Print(std::ostream& os, int depth) const {
-                static auto PrintLines = [](std::ostream& os, int32_t depth) {
-                    if (depth > 0) {
-                        for (int32_t i = 1; i < depth; ++i) {
-                            os << "|   ";
-                        }
-                        os << "|---";
-                    }
-                };
-                PrintLines(os, depth);
-                os << "(" << value << ", " << (color == Color::red ? 'r' : 'b') << ")\n";
-                if (left) {
-                    left->Print(os, depth + 1);
-                } else {
-                    PrintLines(os, depth + 1);
-                    os << "(NIL, b)\n";
-                }
-                if (right) {
-                    right->Print(os, depth + 1);
-                } else {
-                    PrintLines(os, depth + 1);
-                    os << "(NIL, b)\n";
-                }
+            BasicIterator(const RedBlackTree* tree, NodePointer node) : tree_(tree), node_(node) {
             }
 
-            Node* parent;
-            std::unique_ptr<Node> left;
-            std::unique_ptr<Node> right;
-            T value;
-            Color color;
-        };
-
-        class ConstIterator {
-        public:
-            using iterator_category = std::forward_iterator_tag;
-            using value_type = T;
-
-            explicit ConstIterator(const Node* node) : node_(node) {
+            template<typename OtherValue>
+                requires(std::is_const_v<Value> && !std::is_const_v<OtherValue>)
+            BasicIterator(const BasicIterator<OtherValue>& other)
+                : tree_(other.tree_), node_(other.node_) {
             }
 
-            ConstIterator& operator++() {
+            BasicIterator& operator++() {
                 assert(node_);
                 node_ = NextNode(node_);
                 return *this;
             }
 
-            ConstIterator operator++(int) {
+            BasicIterator operator++(int) {
+                BasicIterator result = *this;
+                ++*this;
+                return result;
+            }
+
+            BasicIterator& operator--() {
+                node_ = node_ ? PrevNode(node_) : tree_->rightmost_;
                 assert(node_);
-                return ConstIterator(Node::NextNode(node_));
+                return *this;
+            }
+
+            BasicIterator operator--(int) {
+                BasicIterator result = *this;
+                --*this;
+                return result;
             }
 
-            bool operator!=(const ConstIterator& other) const {
-                return node_ != other.node_;
+            bool operator==(const BasicIterator& other) const {
+                return node_ == other.node_;
             }
 
-            const T& operator*() {
+            reference operator*() const {
                 return node_->value;
             }
 
-            const T* operator->() {
+            pointer operator->() const {
                 return &node_->value;
             }
 
         private:
-            const Node* node_;
+            template<typename OtherValue>
+            friend class BasicIterator;
+            friend class RedBlackTree;
+
+            const RedBlackTree* tree_ = nullptr;
+            NodePointer node_ = nullptr;
         };
 
+        Iterator begin() {
+            return Iterator(this, leftmost_);
+        }
+
         ConstIterator begin() const {
-            return ConstIterator(FirstNode());
+            return ConstIterator(this, leftmost_);
+        }
+
+        Iterator end() {
+            return Iterator(this, nullptr);
         }
 
         ConstIterator end() const {
-            return ConstIterator(nullptr);
+            return ConstIterator(this, nullptr);
+        }
+
+        ReverseIterator rbegin() {
+            return ReverseIterator(end());
+        }
+
+        ConstReverseIterator rbegin() const {
+            return ConstReverseIterator(end());
         }
 
-        friend std::ostream& operator<<(std::ostream& os, const RedBlackTree<T>& t) {
+        ReverseIterator rend() {
+            return ReverseIterator(begin());
+        }
+
+        ConstReverseIterator rend() const {
+            return ConstReverseIterator(begin());
+        }
+
+        friend std::ostream& operator<<(std::ostream& os, const RedBlackTree& t) {
             if (!t.root_) {
                 return os << "Empty\n";
             }
@@ -544,6 +1785,9 @@ namespace DSVisualization {
             if (black_depth == 0 && node->color == Color::red) {
                 return false;
             }
+            if (node->size != NodeSize(node->left) + NodeSize(node->right) + 1) {
+                return false;
+            }
             if (node->color == Color::black) {
                 ++black_depth;
             } else {
@@ -552,63 +1796,54 @@ namespace DSVisualization {
                     return false;
                 }
             }
-            if (!CheckInvariants(node->left.get(), values, depths, black_depth)) {
+            if (!CheckInvariants(node->left, values, depths, black_depth)) {
                 return false;
             }
             values->push_back(node->value);
-            if (!CheckInvariants(node->right.get(), values, depths, black_depth)) {
+            if (!CheckInvariants(node->right, values, depths, black_depth)) {
                 return false;
             }
             return true;
         }
 #endif
-        static const Node* NextNode(const Node* node) {
-            if (node->right) {
-                node = node->right.get();
-                while (node->left) {
-                    node = node->left.get();
-                }
-                return node;
-            }
-            while (node->parent && node->parent->right.get() == node) {
-                node = node->parent;
-            }
-            if (!node->parent) {
-                return nullptr;
-            }
-            node = node->parent;
-            return node;
+        // In-order successor and predecessor, nullptr after the last and before the first node
+        template<typename NodePointer>
+        static NodePointer NextNode(NodePointer node) {
+            return StepNode(node, &Node::left, &Node::right);
+        }
+
+        template<typename NodePointer>
+        static NodePointer PrevNode(NodePointer node) {
+            return StepNode(node, &Node::right, &Node::left);
         }
 
-        static Node* NextNode(Node* node) {
-            if (node->right) {
-                node = node->right.get();
-                while (node->left) {
-                    node = node->left.get();
+        template<typename NodePointer>
+        static NodePointer StepNode(NodePointer node, NodePtr Node::*back,
+                                    NodePtr Node::*forward) {
+            if (node->*forward) {
+                node = node->*forward;
+                while (node->*back) {
+                    node = node->*back;
                 }
                 return node;
             }
-            while (node->parent && node->parent->right.get() == node) {
+            while (node->parent && node->parent->*forward == node) {
                 node = node->parent;
             }
-            if (!node->parent) {
-                return nullptr;
-            }
-            node = node->parent;
-            return node;
+            return node->parent;
         }
 
         NodePtr GetNearestLeaf(NodePtr node) {
-            NodePtr node_to_delete = node->right.get();
+            NodePtr node_to_delete = node->right;
             if (node_to_delete) {
                 while (node_to_delete->left) {
-                    node_to_delete = node_to_delete->left.get();
+                    node_to_delete = node_to_delete->left;
                 }
             } else {
                 if (node->left) {
-                    node_to_delete = node->left.get();
+                    node_to_delete = node->left;
                     while (node_to_delete->right) {
-                        node_to_delete = node_to_delete->right.get();
+                        node_to_delete = node_to_delete->right;
                     }
                 }
             }
@@ -632,46 +1867,173 @@ namespace DSVisualization {
             return node->color;
         }
 
-        std::unique_ptr<Node> root_ = nullptr;
-        Observable<TreeInfo<T>> port_;
+        using NodeAllocator =
+                typename std::allocator_traits<Allocator>::template rebind_alloc<Node>;
+        using NodeAllocatorTraits = std::allocator_traits<NodeAllocator>;
+
+        NodePtr root_ = nullptr;
+        // The first and the last nodes, so that begin() and rbegin() are O(1)
+        NodePtr leftmost_ = nullptr;
+        NodePtr rightmost_ = nullptr;
+        Port port_;
+        Event last_event_ = Event::TreeReplaced(nullptr, 0);
+        [[no_unique_address]] Limiter frame_limiter_;
+        // The pieces cut off by Split are out of the tree until they are joined back, the
+        // frames in between would show them unlinked. Their events are sent all the same.
+        bool frames_held_ = false;
         size_t size_ = 0;
+        NodeAllocator node_allocator_;
+        [[no_unique_address]] Compare compare_;
     };
 
-    template<typename T>
-    class TreeInfoWrapper : public TreeInfo<T> {
+    // Sends the changes made by one operation of a traced tree. The operation lasts as long
+    // as the tracer: it is started on construction, and the final step is sent on destruction.
+    template<typename T, typename Augmentation>
+    class TreeEventTracer {
+        using Node = RedBlackTreeNode<T, Augmentation>;
+        using Event = TreeEvent<Node>;
+
     public:
-        TreeInfoWrapper(TreeInfo<T> tree_info, std::function<void(TreeInfo<T>)> deleter)
-            : TreeInfo<T>(std::move(tree_info)), deleter_(std::move(deleter)) {
+        TreeEventTracer(std::function<void(const Event&)> send, const Node* root,
+                        const size_t* tree_size)
+            : send_(std::move(send)), tree_size_(tree_size) {
+            send_(Event::OperationStarted(root, *tree_size_));
+        }
+
+        TreeEventTracer(const TreeEventTracer&) = delete;
+        TreeEventTracer& operator=(const TreeEventTracer&) = delete;
+        TreeEventTracer(TreeEventTracer&&) = delete;
+        TreeEventTracer& operator=(TreeEventTracer&&) = delete;
+
+        ~TreeEventTracer() {
+            Step();
+            send_(Event::OperationFinished());
+        }
+
+        TreeEventTracer& SetNodeStatus(const Node* node, Status status) {
+            if (node) {
+                send_(Event::StatusChanged(node, status));
+            }
+            return *this;
+        }
+
+        TreeEventTracer& Create(const Node* node) {
+            send_(Event::NodeCreated(node, node->value, node->color));
+            return *this;
+        }
+
+        TreeEventTracer& Recolor(const Node* node, Color color) {
+            send_(Event::Recolor(node, color));
+            return *this;
+        }
+
+        TreeEventTracer& Link(const Node* parent, Kid side, const Node* kid) {
+            send_(Event::LinkChanged(parent, side, kid));
+            return *this;
         }
 
-        TreeInfo<T>& GetTreeInfo() {
-            return *static_cast<TreeInfo<T>*>(this);
+        TreeEventTracer& Rotation(const Node* node, Kid direction) {
+            send_(Event::Rotation(node, direction));
+            return *this;
+        }
+
+        TreeEventTracer& Destroy(const Node* node) {
+            send_(Event::NodeDestroyed(node));
+            return *this;
         }
 
-        ~TreeInfoWrapper() {
-            deleter_(std::move(GetTreeInfo()));
+        void Step() {
+            send_(Event::Step(*tree_size_));
         }
 
     private:
-        std::function<void(TreeInfo<T>)> deleter_;
+        std::function<void(const Event&)> send_;
+        const size_t* tree_size_;
     };
 
-    template<typename T>
+    template<typename T, typename Augmentation, typename NodeType>
     struct TreeInfo {
+        using Node = NodeType;
+
         size_t tree_size = 0;
-        const typename RedBlackTree<T>::Node* root = nullptr;
-        std::unordered_map<const typename RedBlackTree<T>::Node*, Status> node_to_status;
+        const Node* root = nullptr;
+        std::unordered_map<const Node*, Status> node_to_status;
+        // Keeps the nodes alive when they are shared between versions of a tree, e.g. for a
+        // snapshot of PersistentRedBlackTree. Empty for RedBlackTree, whose nodes are only
+        // valid while the tree is not changed.
+        std::shared_ptr<const void> version;
 
-        TreeInfo<T>& SetNodeStatus(const typename RedBlackTree<T>::Node* node, Status status) {
+        TreeInfo& SetNodeStatus(const Node* node, Status status) {
             node_to_status[node] = status;
             return *this;
         }
+
+        TreeInfo& SetRoot(const Node* new_root) {
+            root = new_root;
+            return *this;
+        }
     };
 
-    template<typename T>
-    TreeInfo<T> GetTreeInfo(RedBlackTree<T>& red_black_tree) {
-        TreeInfo<T> tree_info;
-        tree_info.root = red_black_tree.Root();
-        return tree_info;
-    }
+    // Puts a TreeInfo together from the events of a traced tree, each event is applied in O(1).
+    // The statuses of an operation are dropped when it finishes, so the statuses of the
+    // operation it is nested in come back.
+    template<typename T, typename Augmentation = NoAugmentation>
+    class TreeInfoBuilder {
+    public:
+        using Data = TreeInfo<T, Augmentation>;
+        using Event = TreeEvent<RedBlackTreeNode<T, Augmentation>>;
+
+        // Returns true if the event completes a step, then GetTreeInfo() is the frame to draw
+        bool Apply(const Event& event) {
+            switch (event.type) {
+                case TreeEventType::operation_started:
+                    outer_statuses_.push_back(std::move(tree_info_.node_to_status));
+                    tree_info_.node_to_status.clear();
+                    tree_info_.root = event.node;
+                    tree_info_.tree_size = event.tree_size;
+                    return false;
+                case TreeEventType::operation_finished:
+                    if (outer_statuses_.empty()) {
+                        tree_info_.node_to_status.clear();
+                    } else {
+                        tree_info_.node_to_status = std::move(outer_statuses_.back());
+                        outer_statuses_.pop_back();
+                    }
+                    return false;
+                case TreeEventType::tree_replaced:
+                    tree_info_.node_to_status.clear();
+                    outer_statuses_.clear();
+                    tree_info_.root = event.node;
+                    tree_info_.tree_size = event.tree_size;
+                    return false;
+                case TreeEventType::status_changed:
+                    tree_info_.node_to_status[event.node] = event.status;
+                    return false;
+                case TreeEventType::link_changed:
+                    if (!event.node) {
+                        tree_info_.root = event.other;
+                    }
+                    return false;
+                case TreeEventType::node_destroyed:
+                    tree_info_.node_to_status.erase(event.node);
+                    for (auto& statuses : outer_statuses_) {
+                        statuses.erase(event.node);
+                    }
+                    return false;
+                case TreeEventType::step:
+                    tree_info_.tree_size = event.tree_size;
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        [[nodiscard]] const Data& GetTreeInfo() const {
+            return tree_info_;
+        }
+
+    private:
+        Data tree_info_;
+        std::vector<std::unordered_map<const typename Data::Node*, Status>> outer_statuses_;
+    };
 }// namespace DSVisualization
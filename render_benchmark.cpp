@@ -0,0 +1,154 @@
+#include "red_black_tree.h"
+#include "tree_layout.h"
+#include "tree_mirror.h"
+#include "view.h"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string_view>
+#include <vector>
+
+#include <QApplication>
+#include <QImage>
+
+// Times the drawing of View frame by frame on the offscreen platform of Qt, so it runs without
+// a display:
+//   data_structure_visualization_render_benchmark [QUERIES]
+// For trees of 1k, 10k and 100k nodes it draws every frame of QUERIES random inserts and
+// erases, 100 by default, and prints the percentiles of the time of each stage of a frame:
+// layout (applying the events and filling the DrawableTree), scene (updating the items of
+// the scene) and paint (rendering the visible part of the tree into a QImage).
+namespace DSVisualization {
+    class ViewBenchmark {
+    public:
+        explicit ViewBenchmark(View* view) : view_(view) {
+        }
+
+        void Run(size_t tree_size, size_t queries_count) {
+            RedBlackTree<int> tree;
+            TreeMirror<int> mirror;
+            TreeLayout<int> layout;
+            layout_times_.clear();
+            scene_times_.clear();
+            paint_times_.clear();
+            Clock::duration apply_time{};
+            Observer<View::Event> observer([&](const View::Event& event) {
+                auto start = Clock::now();
+                layout.Apply(event);
+                bool frame_ended = mirror.Apply(event);
+                apply_time += Clock::now() - start;
+                if (frame_ended) {
+                    DrawFrame(mirror, layout, apply_time);
+                    apply_time = {};
+                }
+            });
+            tree.SubscribeToEvents(&observer);
+            std::vector<int> values(tree_size);
+            for (size_t i = 0; i < tree_size; ++i) {
+                values[i] = static_cast<int>(2 * i);
+            }
+            tree.BuildFromSorted(values.begin(), values.end());
+            std::mt19937 gen(static_cast<unsigned>(tree_size));
+            std::uniform_int_distribution<int> value(0, static_cast<int>(2 * tree_size));
+            for (size_t i = 0; i < queries_count; ++i) {
+                if (gen() % 2 == 0) {
+                    tree.Insert(value(gen));
+                } else {
+                    tree.Erase(value(gen));
+                }
+            }
+            // Not to draw the empty tree the destructor sends
+            observer.Unsubscribe();
+
+            std::cout << "n = " << tree_size << ", " << layout_times_.size() << " frames\n";
+            Report("layout", layout_times_);
+            Report("scene", scene_times_);
+            Report("paint", paint_times_);
+        }
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        static double ToMicroseconds(Clock::duration duration) {
+            return std::chrono::duration<double, std::micro>(duration).count();
+        }
+
+        static void Report(const char* stage, std::vector<double> times) {
+            if (times.empty()) {
+                return;
+            }
+            std::sort(times.begin(), times.end());
+            double total = 0;
+            for (double time : times) {
+                total += time;
+            }
+            auto percentile = [&times](size_t percent) {
+                return times[(times.size() - 1) * percent / 100];
+            };
+            std::cout << "  " << std::setw(6) << stage << ": mean " << std::fixed
+                      << std::setprecision(1) << total / static_cast<double>(times.size())
+                      << " us, p50 " << percentile(50) << " us, p90 " << percentile(90)
+                      << " us, p99 " << percentile(99) << " us, max " << times.back() << " us\n";
+        }
+
+        void DrawFrame(const TreeMirror<int>& mirror, const TreeLayout<int>& layout,
+                       Clock::duration apply_time) {
+            // The view holds the other frame, the one it drew last
+            std::shared_ptr<DrawableTree>& frame = frames_[next_frame_];
+            next_frame_ ^= 1;
+            auto start = Clock::now();
+            view_->LayOutFrame(mirror, layout, frame.get());
+            auto filled = Clock::now();
+            view_->DrawFrame(frame);
+            auto drawn = Clock::now();
+            view_->PaintTree(&image_);
+            auto painted = Clock::now();
+            layout_times_.push_back(ToMicroseconds(apply_time + (filled - start)));
+            scene_times_.push_back(ToMicroseconds(drawn - filled));
+            paint_times_.push_back(ToMicroseconds(painted - drawn));
+        }
+
+        View* view_;
+        std::shared_ptr<DrawableTree> frames_[2] = {std::make_shared<DrawableTree>(),
+                                                    std::make_shared<DrawableTree>()};
+        size_t next_frame_ = 0;
+        QImage image_;
+        std::vector<double> layout_times_;
+        std::vector<double> scene_times_;
+        std::vector<double> paint_times_;
+    };
+}// namespace DSVisualization
+
+int main(int argc, char* argv[]) {
+    size_t queries_count = 100;
+    if (argc > 2) {
+        std::cerr << "usage: " << argv[0] << " [QUERIES]\n";
+        return 2;
+    }
+    if (argc == 2) {
+        std::string_view arg = argv[1];
+        auto [end, error] = std::from_chars(arg.data(), arg.data() + arg.size(), queries_count);
+        if (error != std::errc() || end != arg.data() + arg.size()) {
+            std::cerr << "usage: " << argv[0] << " [QUERIES]\n";
+            return 2;
+        }
+    }
+    // Nothing is shown on the screen, a platform given by the environment is kept
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication q_app(argc, argv);
+    DSVisualization::View view;
+    // The main window shows itself, its viewport gets its size from the events of the show
+    QApplication::processEvents();
+    DSVisualization::ViewBenchmark benchmark(&view);
+    for (size_t tree_size : {size_t{1000}, size_t{10000}, size_t{100000}}) {
+        benchmark.Run(tree_size, queries_count);
+    }
+    return 0;
+}
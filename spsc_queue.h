@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+namespace DSVisualization {
+    // Bounded lock-free queue for exactly one producer thread and one consumer thread. The
+    // slots form a ring of power of two size. Each side owns one index, publishes it with
+    // release and reads the other one with acquire. It also caches the last index it read, so
+    // it only touches the other side's cache line when the ring looks full or empty.
+    template<typename T>
+    class SpscQueue {
+    public:
+        explicit SpscQueue(size_t capacity)
+            : slots_(std::bit_ceil(capacity)), mask_(slots_.size() - 1) {
+            assert(capacity > 0);
+        }
+
+        SpscQueue(const SpscQueue&) = delete;
+        SpscQueue& operator=(const SpscQueue&) = delete;
+        SpscQueue(SpscQueue&&) = delete;
+        SpscQueue& operator=(SpscQueue&&) = delete;
+
+        // Producer only. Returns false if the queue is full.
+        bool TryPush(const T& value) {
+            size_t tail = tail_.load(std::memory_order_relaxed);
+            if (tail - cached_head_ == slots_.size()) {
+                cached_head_ = head_.load(std::memory_order_acquire);
+                if (tail - cached_head_ == slots_.size()) {
+                    return false;
+                }
+            }
+            slots_[tail & mask_] = value;
+            tail_.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer only. Returns false if the queue is empty.
+        bool TryPop(T* value) {
+            size_t head = head_.load(std::memory_order_relaxed);
+            if (head == cached_tail_) {
+                cached_tail_ = tail_.load(std::memory_order_acquire);
+                if (head == cached_tail_) {
+                    return false;
+                }
+            }
+            *value = slots_[head & mask_];
+            head_.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        [[nodiscard]] size_t Capacity() const {
+            return slots_.size();
+        }
+
+        // Exact only when called by one of the sides while the other one is idle
+        [[nodiscard]] size_t SizeApprox() const {
+            return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+        }
+
+    private:
+        static constexpr size_t cache_line_size = 64;
+
+        std::vector<T> slots_;
+        size_t mask_;
+        // Written by the consumer
+        alignas(cache_line_size) std::atomic<size_t> head_ = 0;
+        size_t cached_tail_ = 0;
+        // Written by the producer
+        alignas(cache_line_size) std::atomic<size_t> tail_ = 0;
+        size_t cached_head_ = 0;
+    };
+}// namespace DSVisualization
@@ -0,0 +1,232 @@
+#include "../../controller.h"
+#include "../../event_pipeline.h"
+#include "../../queries.h"
+#include "../../red_black_tree.h"
+#include "../../spsc_queue.h"
+#include "../../tree_mirror.h"
+
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace DSVisualization {
+    namespace {
+        using Model = RedBlackTree<int>;
+        using Event = Model::Event;
+        using Mirror = TreeMirror<int>;
+
+        void MirrorValues(const Mirror& mirror, Mirror::NodeId id, std::vector<int>* values) {
+            const Mirror::Node* node = mirror.Find(id);
+            if (!node) {
+                return;
+            }
+            MirrorValues(mirror, node->left, values);
+            values->push_back(node->value);
+            MirrorValues(mirror, node->right, values);
+        }
+
+        std::vector<int> MirrorValues(const Mirror& mirror) {
+            std::vector<int> values;
+            MirrorValues(mirror, mirror.Root(), &values);
+            return values;
+        }
+
+        struct Drained {
+            size_t steps = 0;
+            size_t events = 0;
+        };
+
+        // Pops the events until the producer is done and the queue is empty, sleeping now and
+        // then to fall behind the producer
+        Drained Drain(EventPipeline<Event>* pipeline, Mirror* mirror,
+                      const std::atomic<bool>& producer_done) {
+            Drained drained;
+            Event event;
+            while (true) {
+                bool done = producer_done.load();
+                if (!pipeline->TryPop(&event)) {
+                    if (done) {
+                        return drained;
+                    }
+                    std::this_thread::yield();
+                    continue;
+                }
+                ++drained.events;
+                if (mirror->Apply(event)) {
+                    ++drained.steps;
+                }
+                if (drained.events % 64 == 0) {
+                    std::this_thread::sleep_for(std::chrono::microseconds(50));
+                }
+            }
+        }
+
+        void RunModelOnItsThread(Backpressure backpressure) {
+            Model model;
+            EventPipeline<Event> pipeline(32, backpressure);
+            size_t steps = 0;
+            Observer<Event> step_counter([&steps](const Event& event) {
+                steps += (event.type == TreeEventType::step);
+            });
+            model.SubscribeToEvents(pipeline.GetObserver());
+            model.SubscribeToEvents(&step_counter);
+
+            std::atomic<bool> producer_done = false;
+            std::thread model_thread([&model, &producer_done]() {
+                std::mt19937 gen(1);
+                std::uniform_int_distribution<int> value(0, 40);
+                for (int i = 0; i < 300; ++i) {
+                    if (gen() % 3) {
+                        model.Insert(value(gen));
+                    } else {
+                        model.Erase(value(gen));
+                    }
+                }
+                producer_done.store(true);
+            });
+            Mirror mirror;
+            Drained drained = Drain(&pipeline, &mirror, producer_done);
+            model_thread.join();
+
+            ASSERT_EQ(MirrorValues(mirror), std::vector<int>(model.begin(), model.end()));
+            ASSERT_EQ(mirror.Size(), model.Size());
+            ASSERT_EQ(drained.steps + pipeline.DroppedFrames() + pipeline.MergedFrames(), steps);
+            if (backpressure == Backpressure::block) {
+                ASSERT_EQ(drained.steps, steps);
+            }
+        }
+    }// namespace
+
+    TEST(SpscQueue, KeepsOrderBetweenThreads) {
+        SpscQueue<int> queue(100);
+        ASSERT_EQ(queue.Capacity(), 128);
+        constexpr int count = 200000;
+        std::thread producer([&queue]() {
+            for (int i = 0; i < count; ++i) {
+                while (!queue.TryPush(i)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+        for (int expected = 0; expected < count;) {
+            int value = -1;
+            if (queue.TryPop(&value)) {
+                ASSERT_EQ(value, expected);
+                ++expected;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        producer.join();
+        int value = -1;
+        ASSERT_FALSE(queue.TryPop(&value));
+    }
+
+    TEST(SpscQueue, RefusesWhenFull) {
+        SpscQueue<int> queue(4);
+        for (int i = 0; i < 4; ++i) {
+            ASSERT_TRUE(queue.TryPush(i));
+        }
+        ASSERT_FALSE(queue.TryPush(4));
+        ASSERT_EQ(queue.SizeApprox(), 4);
+        int value = -1;
+        ASSERT_TRUE(queue.TryPop(&value));
+        ASSERT_EQ(value, 0);
+        ASSERT_TRUE(queue.TryPush(4));
+    }
+
+    TEST(EventPipeline, Block) {
+        RunModelOnItsThread(Backpressure::block);
+    }
+
+    TEST(EventPipeline, DropFrames) {
+        RunModelOnItsThread(Backpressure::drop_frames);
+    }
+
+    TEST(EventPipeline, Coalesce) {
+        RunModelOnItsThread(Backpressure::coalesce);
+    }
+
+    TEST(EventPipeline, ClosedPipelineDoesNotWait) {
+        Model model;
+        EventPipeline<Event> pipeline(8, Backpressure::block);
+        model.SubscribeToEvents(pipeline.GetObserver());
+        pipeline.Close();
+        for (int x = 0; x < 100; ++x) {
+            model.Insert(x);
+        }
+        ASSERT_EQ(model.Size(), 100);
+    }
+
+    TEST(EventPipeline, ControllerRunsTheModel) {
+        Model model;
+        EventPipeline<Event> pipeline;
+        model.SubscribeToEvents(pipeline.GetObserver());
+        Controller controller(model);
+        TreeQuery query;
+        Observable<TreeQuery> view([&query]() {
+            return query;
+        });
+        view.Subscribe(controller.GetObserver());
+        for (int x = 0; x < 50; ++x) {
+            query = TreeQuery{x % 5 == 4 ? TreeQueryType::erase : TreeQueryType::insert, x / 2};
+            view.Notify();
+        }
+        controller.WaitUntilIdle();
+
+        Mirror mirror;
+        Event event;
+        while (pipeline.TryPop(&event)) {
+            mirror.Apply(event);
+        }
+        ASSERT_EQ(MirrorValues(mirror), std::vector<int>(model.begin(), model.end()));
+    }
+
+    TEST(EventPipeline, ControllerQueue) {
+        Model model;
+        Controller controller(model);
+        std::atomic<bool> started = false;
+        std::atomic<bool> released = false;
+        controller.Enqueue(TreeQuery{TreeQueryType::insert, -1},
+                           [&started, &released](const Controller::QueryResult&) {
+                               started.store(true);
+                               while (!released.load()) {
+                                   std::this_thread::yield();
+                               }
+                           });
+        while (!started.load()) {
+            std::this_thread::yield();
+        }
+        // The model thread is held by the first callback, the rest wait in the queue
+        std::vector<Controller::QueryResult> results;
+        for (int x = 0; x < 20; ++x) {
+            TreeQueryType type = x % 4 == 3 ? TreeQueryType::find : TreeQueryType::insert;
+            controller.Enqueue(TreeQuery{type, x / 2},
+                               [&results](const Controller::QueryResult& result) {
+                                   results.push_back(result);
+                               });
+        }
+        size_t depth = controller.GetQueueStats().depth;
+        released.store(true);
+        ASSERT_EQ(depth, 20);
+        controller.WaitUntilIdle();
+
+        Controller::QueueStats stats = controller.GetQueueStats();
+        ASSERT_EQ(stats.depth, 0);
+        ASSERT_EQ(stats.handled, 21);
+        ASSERT_GE(stats.max_wait_time, stats.last_wait_time);
+        ASSERT_GE(stats.total_wait_time, stats.max_wait_time);
+        ASSERT_EQ(results.size(), 20);
+        for (int x = 0; x < 20; ++x) {
+            const Controller::QueryResult& result = results[x];
+            ASSERT_EQ(result.query.value, x / 2);
+            // Every other insert repeats the value before it, the finds look for present values
+            bool repeated = result.query.query_type == TreeQueryType::insert && x % 2 == 1;
+            ASSERT_EQ(result.success, !repeated);
+        }
+        ASSERT_EQ(model.Size(), 11);
+    }
+}// namespace DSVisualization
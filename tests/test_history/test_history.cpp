@@ -0,0 +1,155 @@
+#include "../../controller.h"
+#include "../../history.h"
+#include "../../queries.h"
+#include "../../red_black_tree.h"
+
+#include <random>
+#include <set>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace DSVisualization {
+    namespace {
+        using Model =
+                RedBlackTree<int, Tracing, std::allocator<int>, NoAugmentation, std::less<int>>;
+
+        std::vector<TreeQuery> RandomSession(size_t size, int max_value, uint32_t seed) {
+            std::mt19937 gen(seed);
+            std::uniform_int_distribution<int> value(0, max_value);
+            std::bernoulli_distribution is_insert(0.6);
+            std::vector<TreeQuery> session;
+            for (size_t i = 0; i < size; ++i) {
+                session.push_back(TreeQuery{
+                        is_insert(gen) ? TreeQueryType::insert : TreeQueryType::erase, value(gen)});
+            }
+            return session;
+        }
+
+        // Sets after every step of the session, states[i] is the set after i queries
+        std::vector<std::set<int>> Replay(const std::vector<TreeQuery>& session) {
+            std::vector<std::set<int>> states(1);
+            for (const TreeQuery& query : session) {
+                states.push_back(states.back());
+                if (query.query_type == TreeQueryType::insert) {
+                    states.back().insert(query.value);
+                } else {
+                    states.back().erase(query.value);
+                }
+            }
+            return states;
+        }
+
+        std::set<int> ModelValues(const Model& model) {
+            return std::set<int>(model.begin(), model.end());
+        }
+    }// namespace
+
+    TEST(History, GoToEveryStep) {
+        constexpr size_t session_size = 2000;
+        std::vector<TreeQuery> session = RandomSession(session_size, 300, 1);
+        std::vector<std::set<int>> states = Replay(session);
+        History history(8, 16);
+        for (const TreeQuery& query : session) {
+            history.Record(query);
+        }
+        ASSERT_EQ(history.StepCount(), session_size);
+        ASSERT_EQ(history.CurrentStep(), session_size);
+
+        Model model;
+        std::mt19937 gen(2);
+        std::uniform_int_distribution<size_t> step(0, session_size);
+        for (size_t i = 0; i < 500; ++i) {
+            size_t target = step(gen);
+            history.GoToStep(target, model);
+            ASSERT_EQ(history.CurrentStep(), target);
+            ASSERT_EQ(ModelValues(model), states[target]);
+            ASSERT_LE(history.LastReplayLength(), history.CheckpointInterval());
+        }
+        for (size_t target = 0; target <= session_size; ++target) {
+            history.GoToStep(target, model);
+            ASSERT_EQ(ModelValues(model), states[target]);
+            ASSERT_LE(history.LastReplayLength(), 1);
+        }
+    }
+
+    TEST(History, CheckpointsAreBounded) {
+        constexpr size_t max_checkpoints = 5;
+        History history(max_checkpoints, 4);
+        std::vector<TreeQuery> session = RandomSession(10000, 1000, 3);
+        for (const TreeQuery& query : session) {
+            history.Record(query);
+            ASSERT_LE(history.CheckpointCount(), max_checkpoints);
+            ASSERT_LE(history.StepCount(), history.CheckpointCount() * history.CheckpointInterval());
+        }
+        ASSERT_GT(history.CheckpointInterval(), 4);
+
+        std::vector<std::set<int>> states = Replay(session);
+        Model model;
+        history.GoToStep(session.size() / 3, model);
+        ASSERT_EQ(ModelValues(model), states[session.size() / 3]);
+        ASSERT_LE(history.LastReplayLength(), history.CheckpointInterval());
+    }
+
+    TEST(History, RecordAfterRewindForgetsTheFuture) {
+        History history(4, 2);
+        std::vector<TreeQuery> session = RandomSession(40, 20, 4);
+        for (const TreeQuery& query : session) {
+            history.Record(query);
+        }
+        Model model;
+        history.GoToStep(15, model);
+        std::vector<TreeQuery> branch(session.begin(), session.begin() + 15);
+        for (const TreeQuery& query : RandomSession(10, 20, 5)) {
+            history.Record(query);
+            branch.push_back(query);
+        }
+        ASSERT_EQ(history.StepCount(), 25);
+        std::vector<std::set<int>> states = Replay(branch);
+        for (size_t target : {25, 0, 20, 15, 16, 7}) {
+            history.GoToStep(target, model);
+            ASSERT_EQ(ModelValues(model), states[target]);
+        }
+    }
+
+    TEST(History, OnlyChangesAreRecorded) {
+        History history;
+        history.Record(TreeQuery{TreeQueryType::find, 1});
+        history.Record(TreeQuery{TreeQueryType::do_nothing, 1});
+        history.Record(TreeQuery{TreeQueryType::go_to_step, 0});
+        ASSERT_EQ(history.StepCount(), 0);
+    }
+
+    TEST(History, Controller) {
+        Model model;
+        Controller controller(model, 4);
+        TreeQuery query;
+        Observable<TreeQuery> view([&query]() {
+            return query;
+        });
+        view.Subscribe(controller.GetObserver());
+        auto send = [&](TreeQueryType type, int value) {
+            query = TreeQuery{type, value};
+            view.Notify();
+            controller.WaitUntilIdle();
+        };
+
+        std::vector<TreeQuery> session = RandomSession(300, 50, 6);
+        for (const TreeQuery& session_query : session) {
+            send(session_query.query_type, session_query.value);
+            send(TreeQueryType::find, session_query.value);
+        }
+        ASSERT_EQ(controller.GetHistory().StepCount(), session.size());
+        ASSERT_LE(controller.GetHistory().CheckpointCount(), 4);
+
+        std::vector<std::set<int>> states = Replay(session);
+        send(TreeQueryType::go_to_step, 100);
+        ASSERT_EQ(ModelValues(model), states[100]);
+        send(TreeQueryType::go_to_step, 1000);
+        ASSERT_EQ(ModelValues(model), states[session.size()]);
+        send(TreeQueryType::go_to_step, -1);
+        ASSERT_EQ(ModelValues(model), states[session.size()]);
+        send(TreeQueryType::go_to_step, 0);
+        ASSERT_TRUE(model.Empty());
+    }
+}// namespace DSVisualization
@@ -3,6 +3,12 @@
 
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+
 namespace DSVisualization {
 
     namespace {
@@ -18,6 +24,35 @@ namespace DSVisualization {
         private:
             int& value_;
         };
+
+        // Counts the allocations of the containers which use it, the tests look at the
+        // difference
+        size_t allocations_count = 0;
+
+        template<typename T>
+        struct CountingAllocator {
+            using value_type = T;
+
+            CountingAllocator() = default;
+
+            template<typename U>
+            CountingAllocator(const CountingAllocator<U>&) {
+            }
+
+            T* allocate(size_t n) {
+                ++allocations_count;
+                return std::allocator<T>().allocate(n);
+            }
+
+            void deallocate(T* ptr, size_t n) {
+                std::allocator<T>().deallocate(ptr, n);
+            }
+
+            template<typename U>
+            bool operator==(const CountingAllocator<U>&) const {
+                return true;
+            }
+        };
     }// namespace
 
     TEST(ObserverObservable, Notify) {
@@ -99,30 +134,105 @@ namespace DSVisualization {
 
     TEST(ObserverObservable, MultipleSubscriptions) {
         int x = 0;
-        size_t observers_count = 10;
+        const int observers_count = 10;
         std::vector<int> values(observers_count);
         {
             Observable<int> observable_x([&x]() {
                 return ++x;
             });
             std::vector<std::unique_ptr<Observer<int>>> observers(observers_count);
-            for (size_t i = 0; i < observers_count; ++i) {
+            for (int i = 0; i < observers_count; ++i) {
                 observers[i] = std::make_unique<Observer<int>>(
                         ValueSetter(values[i]), ValueSetter(values[i]), ValueSetter(values[i]));
             }
-            for (size_t i = 0; i < observers_count; ++i) {
+            for (int i = 0; i < observers_count; ++i) {
                 observable_x.Subscribe(observers[i].get());
             }
-            for (size_t i = 0; i < observers_count; ++i) {
+            for (int i = 0; i < observers_count; ++i) {
                 ASSERT_TRUE(values[i] == i + 1);
             }
             observable_x.Notify();
-            for (size_t i = 0; i < observers_count; ++i) {
+            for (int i = 0; i < observers_count; ++i) {
                 ASSERT_TRUE(values[i] == observers_count + i + 1);
             }
         }
-        for (size_t i = 0; i < observers_count; ++i) {
+        for (int i = 0; i < observers_count; ++i) {
             ASSERT_TRUE(values[i] == 2 * observers_count + i + 1);
         }
     }
+
+    TEST(ObserverObservable, ShareCopiesNothing) {
+        using Payload =
+                std::map<int, int, std::less<>, CountingAllocator<std::pair<const int, int>>>;
+        Payload data;
+        for (int i = 0; i < 1000; ++i) {
+            data[i] = i;
+        }
+        const int notifications_count = 100;
+        for (size_t observers_count : {1, 10, 100}) {
+            Observable<Payload> observable([&data]() {
+                return data;
+            });
+            size_t seen = 0;
+            std::vector<std::unique_ptr<Observer<Payload>>> observers;
+            for (size_t i = 0; i < observers_count; ++i) {
+                observers.push_back(std::make_unique<Observer<Payload>>(
+                        [&seen](const Payload& payload) { seen += payload.size(); }));
+                observable.Subscribe(observers.back().get());
+            }
+
+            auto measure = [&](auto notify) {
+                size_t before = allocations_count;
+                auto start = std::chrono::steady_clock::now();
+                for (int i = 0; i < notifications_count; ++i) {
+                    notify();
+                }
+                std::chrono::duration<double, std::micro> time =
+                        std::chrono::steady_clock::now() - start;
+                return std::pair{(allocations_count - before) / notifications_count,
+                                 time.count() / notifications_count};
+            };
+            auto [notify_allocations, notify_time] = measure([&] { observable.Notify(); });
+            auto shared = std::make_shared<const Payload>(data);
+            auto [share_allocations, share_time] = measure([&] { observable.Share(shared); });
+            auto [reference_allocations, reference_time] =
+                    measure([&] { observable.SendByReference(data); });
+
+            std::cout << observers_count << " observers, allocations per notify: Notify "
+                      << notify_allocations << ", Share " << share_allocations
+                      << ", SendByReference " << reference_allocations << "; us per notify: "
+                      << std::fixed << std::setprecision(1) << notify_time << ", " << share_time
+                      << ", " << reference_time << "\n";
+            ASSERT_TRUE(notify_allocations >= observers_count * data.size());
+            ASSERT_TRUE(share_allocations == 0);
+            ASSERT_TRUE(reference_allocations == 0);
+            ASSERT_TRUE(seen == 3 * notifications_count * observers_count * data.size());
+        }
+    }
+
+    TEST(ObserverObservable, SharedDataIsGivenOnSubscription) {
+        int x = 0;
+        Observable<int> observable([&x]() {
+            return x;
+        });
+        observable.Share(std::make_shared<const int>(5));
+        int y = 0;
+        Observer<int> observer(ValueSetter(y), Observer<int>::do_nothing,
+                               Observer<int>::do_nothing);
+        observable.Subscribe(&observer);
+        ASSERT_TRUE(y == 5);
+    }
+
+    TEST(ObserverObservable, SentValueReplacesSharedData) {
+        Observable<int> observable([]() {
+            return 0;
+        });
+        observable.Share(std::make_shared<const int>(5));
+        observable.SendByValue(7);
+        int y = 0;
+        Observer<int> observer(ValueSetter(y), Observer<int>::do_nothing,
+                               Observer<int>::do_nothing);
+        observable.Subscribe(&observer);
+        ASSERT_TRUE(y == 7);
+    }
 }// namespace DSVisualization
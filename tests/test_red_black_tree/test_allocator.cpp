@@ -0,0 +1,124 @@
+#include "../../pool_allocator.h"
+#include "../../red_black_tree.h"
+
+#include <random>
+#include <set>
+
+#include <gtest/gtest.h>
+
+namespace DSVisualization {
+    namespace {
+        // Counts the live aggregates, which aren't trivially destructible unlike the values
+        struct Counted {
+            Counted() {
+                ++alive;
+            }
+
+            Counted(const Counted&) {
+                ++alive;
+            }
+
+            Counted& operator=(const Counted&) = default;
+
+            ~Counted() {
+                --alive;
+            }
+
+            static inline int alive = 0;
+        };
+
+        struct CountedAugmentation {
+            using Value = Counted;
+
+            static Value Lift(int) {
+                return {};
+            }
+
+            static Value Combine(const Value&, const Value&) {
+                return {};
+            }
+        };
+    }// namespace
+
+    TEST(Allocator, BlockPoolReusesFreedBlocks) {
+        BlockPool pool(4);
+        ASSERT_TRUE(pool.Fits(sizeof(int64_t), alignof(int64_t)));
+        std::vector<void*> blocks;
+        for (int i = 0; i < 8; ++i) {
+            blocks.push_back(pool.Allocate());
+        }
+        ASSERT_EQ(pool.SlabCount(), 2);
+        pool.Deallocate(blocks[3]);
+        pool.Deallocate(blocks[5]);
+        ASSERT_EQ(pool.Allocate(), blocks[5]);
+        ASSERT_EQ(pool.Allocate(), blocks[3]);
+        ASSERT_EQ(pool.SlabCount(), 2);
+        pool.Release();
+        ASSERT_EQ(pool.SlabCount(), 0);
+    }
+
+    TEST(Allocator, PoolAllocatorCopiesSharePool) {
+        PoolAllocator<int> allocator;
+        PoolAllocator<double> rebound(allocator);
+        ASSERT_TRUE(allocator == rebound);
+        ASSERT_FALSE(allocator == PoolAllocator<int>());
+        ASSERT_FALSE(allocator.ReleaseIfUnique());
+    }
+
+    TEST(Allocator, RandomTestsInsertErasePool) {
+        for (int test = 1; test <= 50; ++test) {
+            std::mt19937 rnd(test);
+            std::uniform_int_distribution<> uid(1, 50);
+            std::uniform_int_distribution<> coin(1, 2);
+            RedBlackTree<int32_t, NoTracing, PoolAllocator<int32_t>> rb_tree(
+                    PoolAllocator<int32_t>(16));
+            std::set<int32_t> s;
+            for (int node = 1; node <= 1000; ++node) {
+                int32_t value = uid(rnd);
+                if (coin(rnd) == 1) {
+                    ASSERT_EQ(rb_tree.Insert(value), s.insert(value).second);
+                } else {
+                    ASSERT_EQ(rb_tree.Erase(value), s.erase(value) == 1);
+                }
+                std::vector<int32_t> values;
+                for (int32_t value : rb_tree) {
+                    values.push_back(value);
+                }
+                ASSERT_TRUE(std::vector<int32_t>(s.begin(), s.end()) == values);
+            }
+            // 50 values fit into 4 slabs of 16 nodes: freed nodes must be reused
+            ASSERT_LE(rb_tree.GetAllocator().Pool().SlabCount(), 4);
+        }
+    }
+
+    TEST(Allocator, Clear) {
+        RedBlackTree<int32_t, NoTracing, PoolAllocator<int32_t>> pool_tree;
+        RedBlackTree<int32_t, NoTracing> heap_tree;
+        for (int i = 1; i <= 10'000; ++i) {
+            pool_tree.Insert(i);
+            heap_tree.Insert(i);
+        }
+        pool_tree.Clear();
+        heap_tree.Clear();
+        ASSERT_TRUE(pool_tree.Empty());
+        ASSERT_TRUE(heap_tree.Empty());
+        ASSERT_FALSE(pool_tree.begin() != pool_tree.end());
+        ASSERT_EQ(pool_tree.GetAllocator().Pool().SlabCount(), 0);
+        ASSERT_TRUE(pool_tree.Insert(1));
+        ASSERT_TRUE(pool_tree.Find(1));
+        ASSERT_EQ(pool_tree.Size(), 1);
+    }
+
+    TEST(Allocator, ClearDestroysAggregates) {
+        {
+            RedBlackTree<int, NoTracing, PoolAllocator<int>, CountedAugmentation> tree;
+            for (int i = 0; i < 50; ++i) {
+                tree.Insert(i);
+            }
+            ASSERT_EQ(Counted::alive, 50);
+            tree.Clear();
+            ASSERT_EQ(Counted::alive, 0);
+        }
+        ASSERT_EQ(Counted::alive, 0);
+    }
+}// namespace DSVisualization
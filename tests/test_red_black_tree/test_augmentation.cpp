@@ -0,0 +1,127 @@
+#include "../../red_black_tree.h"
+
+#include <numeric>
+#include <random>
+#include <set>
+#include <string>
+
+#include <gtest/gtest.h>
+
+namespace DSVisualization {
+    namespace {
+        struct Min {
+            int64_t operator()(int64_t lhs, int64_t rhs) const {
+                return std::min(lhs, rhs);
+            }
+        };
+
+        // Not commutative: checks that the values are folded in order
+        struct ConcatenationAugmentation {
+            using Value = std::string;
+
+            static Value Lift(int64_t value) {
+                return std::to_string(value) + ",";
+            }
+
+            static Value Combine(const Value& lhs, const Value& rhs) {
+                return lhs + rhs;
+            }
+        };
+
+        struct PlainNode {
+            void* parent;
+            void* left;
+            void* right;
+            int value;
+            Color color;
+            size_t size;
+        };
+
+        template<typename Augmentation, typename Fold>
+        void RandomTestsAggregate(Fold fold) {
+            for (int test = 1; test <= 50; ++test) {
+                std::mt19937 rnd(test);
+                std::uniform_int_distribution<int64_t> uid(1, 100);
+                std::uniform_int_distribution<> coin(1, 3);
+                RedBlackTree<int64_t, NoTracing, std::allocator<int64_t>, Augmentation> rb_tree;
+                std::set<int64_t> s;
+                for (int step = 1; step <= 300; ++step) {
+                    int64_t value = uid(rnd);
+                    if (coin(rnd) != 1) {
+                        rb_tree.Insert(value);
+                        s.insert(value);
+                    } else {
+                        rb_tree.Erase(value);
+                        s.erase(value);
+                    }
+                    int64_t lo = uid(rnd);
+                    int64_t hi = uid(rnd);
+                    if (hi < lo) {
+                        ASSERT_EQ(rb_tree.Aggregate(lo, hi), std::nullopt);
+                        std::swap(lo, hi);
+                    }
+                    auto expected = fold(s.lower_bound(lo), s.upper_bound(hi));
+                    ASSERT_EQ(rb_tree.Aggregate(lo, hi), expected);
+                }
+            }
+        }
+    }// namespace
+
+    TEST(Augmentation, NoExtraCost) {
+        static_assert(sizeof(RedBlackTreeNode<int>) == sizeof(PlainNode));
+        static_assert(sizeof(RedBlackTreeNode<int, CombineAugmentation<int, std::plus<>>>) >
+                      sizeof(PlainNode));
+    }
+
+    TEST(Augmentation, Sum) {
+        RandomTestsAggregate<CombineAugmentation<int64_t, std::plus<>>>(
+                [](auto first, auto last) -> std::optional<int64_t> {
+                    if (first == last) {
+                        return std::nullopt;
+                    }
+                    return std::accumulate(first, last, int64_t(0));
+                });
+    }
+
+    TEST(Augmentation, Min) {
+        RandomTestsAggregate<CombineAugmentation<int64_t, Min>>(
+                [](auto first, auto last) -> std::optional<int64_t> {
+                    if (first == last) {
+                        return std::nullopt;
+                    }
+                    return *std::min_element(first, last);
+                });
+    }
+
+    TEST(Augmentation, Concatenation) {
+        RandomTestsAggregate<ConcatenationAugmentation>(
+                [](auto first, auto last) -> std::optional<std::string> {
+                    if (first == last) {
+                        return std::nullopt;
+                    }
+                    std::string result;
+                    for (; first != last; ++first) {
+                        result += ConcatenationAugmentation::Lift(*first);
+                    }
+                    return result;
+                });
+    }
+
+    TEST(Augmentation, JoinSplitBuild) {
+        using Tree = RedBlackTree<int64_t, NoTracing, std::allocator<int64_t>,
+                                  CombineAugmentation<int64_t, std::plus<>>>;
+        std::vector<int64_t> values(1000);
+        std::iota(values.begin(), values.end(), 1);
+        Tree rb_tree(values.begin(), values.end());
+        ASSERT_EQ(rb_tree.Aggregate(1, 1000), 500500);
+        Tree greater;
+        rb_tree.Split(600, greater);
+        ASSERT_EQ(rb_tree.Aggregate(1, 1000), 180300);
+        ASSERT_EQ(greater.Aggregate(1, 1000), 320200);
+        ASSERT_EQ(greater.Aggregate(601, 700), 65050);
+        greater.Erase(601);
+        rb_tree.Join(601, greater);
+        ASSERT_EQ(rb_tree.Aggregate(1, 1000), 500500);
+        ASSERT_EQ(rb_tree.Aggregate(590, 610), 12600);
+    }
+}// namespace DSVisualization
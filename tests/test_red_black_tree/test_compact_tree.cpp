@@ -0,0 +1,67 @@
+#define INVARIANTS_CHECK
+#define NO_LOGGING
+
+#include "../../compact_red_black_tree.h"
+#include "../../red_black_tree.h"
+
+#include <numeric>
+#include <random>
+#include <set>
+
+#include <gtest/gtest.h>
+
+namespace DSVisualization {
+    namespace {
+        template<typename Tree>
+        std::string ToString(const Tree& tree) {
+            std::stringstream ss;
+            ss << tree;
+            return ss.str();
+        }
+    }// namespace
+
+    TEST(CompactTree, NodeSize) {
+        ASSERT_EQ(sizeof(CompactRedBlackTree<int32_t>::Node), 16);
+    }
+
+    TEST(CompactTree, SameShapeAsRedBlackTree) {
+        std::vector<int> p(8);
+        std::iota(p.begin(), p.end(), 1);
+        do {
+            RedBlackTree<int, NoTracing> rb_tree;
+            CompactRedBlackTree<int> compact_tree;
+            for (int x : p) {
+                ASSERT_TRUE(rb_tree.Insert(x));
+                ASSERT_TRUE(compact_tree.Insert(x));
+                ASSERT_TRUE(compact_tree.CheckInvariants());
+            }
+            ASSERT_EQ(ToString(rb_tree), ToString(compact_tree));
+        } while (std::next_permutation(p.begin(), p.end()));
+    }
+
+    TEST(CompactTree, RandomTestsInsertErase) {
+        for (int test = 1; test <= 200; ++test) {
+            std::mt19937 rnd(test);
+            std::uniform_int_distribution<> uid(1, 50);
+            std::uniform_int_distribution<> coin(1, 2);
+            CompactRedBlackTree<int32_t> compact_tree;
+            std::set<int32_t> s;
+            for (int node = 1; node <= 1000; ++node) {
+                int32_t value = uid(rnd);
+                if (coin(rnd) == 1) {
+                    ASSERT_EQ(compact_tree.Insert(value), s.insert(value).second);
+                } else {
+                    ASSERT_EQ(compact_tree.Erase(value), s.erase(value) == 1);
+                }
+                ASSERT_TRUE(compact_tree.CheckInvariants());
+                ASSERT_EQ(compact_tree.Find(value), s.count(value) == 1);
+                ASSERT_EQ(compact_tree.Size(), s.size());
+                std::vector<int32_t> values;
+                for (int32_t x : compact_tree) {
+                    values.push_back(x);
+                }
+                ASSERT_TRUE(std::vector<int32_t>(s.begin(), s.end()) == values);
+            }
+        }
+    }
+}// namespace DSVisualization
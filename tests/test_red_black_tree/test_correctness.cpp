@@ -1,5 +1,6 @@
 #include "../../red_black_tree.h"
 
+#include <numeric>
 #include <random>
 #include <set>
 
@@ -15,31 +16,127 @@ namespace DSVisualization {
             }
             return result;
         }
+
+        template<typename TracingPolicy>
+        void RandomTestsInsertErase() {
+            for (int test = 1; test <= 200; ++test) {
+                std::mt19937 rnd(test);
+                std::uniform_int_distribution<> uid(1, 50);
+                std::uniform_int_distribution<> coin(1, 2);
+                std::stringstream ss;
+                DSVisualization::RedBlackTree<int32_t, TracingPolicy> rb_tree;
+                std::set<int32_t> s;
+                for (int node = 1; node <= 1000; ++node) {
+                    if (coin(rnd) == 1) {
+                        int32_t value = uid(rnd);
+                        rb_tree.Insert(value);
+                        s.insert(value);
+                        ss << "insert " << value << "\n";
+                    } else {
+                        int32_t value = uid(rnd);
+                        rb_tree.Erase(value);
+                        s.erase(value);
+                        ss << "erase " << value << "\n";
+                    }
+                    ASSERT_TRUE(Values(s.begin(), s.end()) ==
+                                Values(rb_tree.begin(), rb_tree.end()));
+                    ASSERT_TRUE(s.size() == rb_tree.Size());
+                    ASSERT_TRUE(s.empty() == rb_tree.Empty());
+                }
+            }
+        }
     }// namespace
 
     TEST(Correctness, RandomTestsInsertErase) {
-        for (int test = 1; test <= 200; ++test) {
+        RandomTestsInsertErase<Tracing>();
+    }
+
+    TEST(Correctness, RandomTestsInsertEraseNoTracing) {
+        RandomTestsInsertErase<NoTracing>();
+    }
+
+    TEST(Correctness, BuildFromSortedSendsOneSnapshot) {
+        size_t snapshots = 0;
+        size_t last_size = 0;
+        Observer<RedBlackTree<int>::Event> observer(
+                [&snapshots, &last_size](const RedBlackTree<int>::Event& event) {
+                    if (event.type == TreeEventType::step) {
+                        ++snapshots;
+                        last_size = event.tree_size;
+                    }
+                });
+        RedBlackTree<int> rb_tree;
+        rb_tree.SubscribeToEvents(&observer);
+        std::vector<int> values(1000);
+        std::iota(values.begin(), values.end(), 1);
+        rb_tree.BuildFromSorted(values.begin(), values.end());
+        ASSERT_EQ(snapshots, 1);
+        ASSERT_EQ(last_size, values.size());
+        ASSERT_TRUE(Values(values.begin(), values.end()) == Values(rb_tree.begin(), rb_tree.end()));
+    }
+
+    TEST(Correctness, JoinReportsRotations) {
+        size_t rotations = 0;
+        size_t rotation_snapshots = 0;
+        TreeInfoBuilder<int> builder;
+        Observer<RedBlackTree<int>::Event> observer(
+                [&rotations, &rotation_snapshots, &builder](const RedBlackTree<int>::Event& event) {
+                    if (event.type == TreeEventType::rotation) {
+                        ++rotations;
+                    }
+                    if (!builder.Apply(event)) {
+                        return;
+                    }
+                    for (const auto& [node, status] : builder.GetTreeInfo().node_to_status) {
+                        if (status == Status::rotate) {
+                            ++rotation_snapshots;
+                            return;
+                        }
+                    }
+                });
+        RedBlackTree<int> left;
+        RedBlackTree<int> right;
+        for (int x = 1; x <= 6; ++x) {
+            left.Insert(x);
+        }
+        right.Insert(8);
+        left.SubscribeToEvents(&observer);
+        left.Join(7, right);
+        ASSERT_GT(rotations, 0);
+        ASSERT_GT(rotation_snapshots, 0);
+        ASSERT_EQ(builder.GetTreeInfo().root, left.Root());
+        ASSERT_EQ(builder.GetTreeInfo().tree_size, 8);
+        ASSERT_EQ(left.Size(), 8);
+        ASSERT_TRUE(right.Empty());
+    }
+
+    TEST(Correctness, OrderStatistics) {
+        for (int test = 1; test <= 100; ++test) {
             std::mt19937 rnd(test);
-            std::uniform_int_distribution<> uid(1, 50);
+            std::uniform_int_distribution<> uid(1, 100);
             std::uniform_int_distribution<> coin(1, 2);
-            std::stringstream ss;
-            DSVisualization::RedBlackTree<int32_t> rb_tree;
+            RedBlackTree<int32_t, NoTracing> rb_tree;
             std::set<int32_t> s;
-            for (int node = 1; node <= 1000; ++node) {
+            for (int node = 1; node <= 500; ++node) {
+                int32_t value = uid(rnd);
                 if (coin(rnd) == 1) {
-                    int32_t value = uid(rnd);
                     rb_tree.Insert(value);
                     s.insert(value);
-                    ss << "insert " << value << "\n";
                 } else {
-                    int32_t value = uid(rnd);
                     rb_tree.Erase(value);
                     s.erase(value);
-                    ss << "erase " << value << "\n";
                 }
-                ASSERT_TRUE(Values(s.begin(), s.end()) == Values(rb_tree.begin(), rb_tree.end()));
-                ASSERT_TRUE(s.size() == rb_tree.Size());
-                ASSERT_TRUE(s.empty() == rb_tree.Empty());
+                int32_t lo = uid(rnd);
+                int32_t hi = uid(rnd);
+                ASSERT_EQ(rb_tree.Rank(value), std::distance(s.begin(), s.lower_bound(value)));
+                ASSERT_EQ(rb_tree.CountInRange(lo, hi),
+                          lo <= hi ? std::distance(s.lower_bound(lo), s.upper_bound(hi)) : 0);
+                size_t k = std::uniform_int_distribution<size_t>(0, s.size())(rnd);
+                if (k == s.size()) {
+                    ASSERT_FALSE(rb_tree.Select(k) != rb_tree.end());
+                } else {
+                    ASSERT_EQ(*rb_tree.Select(k), *std::next(s.begin(), k));
+                }
             }
         }
     }
@@ -0,0 +1,407 @@
+#include "../../event_log.h"
+#include "../../red_black_tree.h"
+#include "../../tree_layout.h"
+#include "../../tree_mirror.h"
+
+#include <algorithm>
+#include <random>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace DSVisualization {
+    namespace {
+        using Tree = RedBlackTree<int>;
+        using Node = Tree::Node;
+        using Event = Tree::Event;
+
+        // Links and colors of the tree as seen through its events only
+        struct Picture {
+            void Apply(const Event& event) {
+                switch (event.type) {
+                    case TreeEventType::tree_replaced:
+                        ASSERT_EQ(event.node, nullptr);
+                        kids.clear();
+                        colors.clear();
+                        root = nullptr;
+                        break;
+                    case TreeEventType::link_changed:
+                        if (!event.node) {
+                            root = event.other;
+                        } else if (event.kid == Kid::left) {
+                            kids[event.node].first = event.other;
+                        } else {
+                            kids[event.node].second = event.other;
+                        }
+                        break;
+                    case TreeEventType::node_created:
+                    case TreeEventType::recolor:
+                        colors[event.node] = event.color;
+                        break;
+                    case TreeEventType::node_destroyed:
+                        kids.erase(event.node);
+                        colors.erase(event.node);
+                        break;
+                    default:
+                        break;
+                }
+            }
+
+            const Node* root = nullptr;
+            std::unordered_map<const Node*, std::pair<const Node*, const Node*>> kids;
+            std::unordered_map<const Node*, Color> colors;
+        };
+
+        void CollectNodes(const Node* node, std::unordered_set<const Node*>* nodes) {
+            if (node) {
+                nodes->insert(node);
+                CollectNodes(node->left, nodes);
+                CollectNodes(node->right, nodes);
+            }
+        }
+    }// namespace
+
+    TEST(Events, PictureFollowsTheTree) {
+        Tree tree;
+        Picture picture;
+        TreeInfoBuilder<int> builder;
+        size_t steps = 0;
+        Observer<Event> observer([&](const Event& event) {
+            picture.Apply(event);
+            if (!builder.Apply(event)) {
+                return;
+            }
+            ++steps;
+            const TreeInfo<int>& info = builder.GetTreeInfo();
+            ASSERT_EQ(picture.root, tree.Root());
+            ASSERT_EQ(info.root, tree.Root());
+            ASSERT_EQ(info.tree_size, tree.Size());
+            std::unordered_set<const Node*> nodes;
+            CollectNodes(tree.Root(), &nodes);
+            for (const Node* node : nodes) {
+                auto [left, right] = picture.kids[node];
+                ASSERT_EQ(left, node->left);
+                ASSERT_EQ(right, node->right);
+                ASSERT_EQ(picture.colors.at(node), node->color);
+            }
+            for (const auto& [node, status] : info.node_to_status) {
+                ASSERT_TRUE(nodes.contains(node));
+            }
+        });
+        tree.SubscribeToEvents(&observer);
+
+        std::mt19937 gen(1);
+        std::uniform_int_distribution<int> value(0, 60);
+        for (int i = 0; i < 2000; ++i) {
+            int x = value(gen);
+            switch (gen() % 3) {
+                case 0:
+                    tree.Insert(x);
+                    break;
+                case 1:
+                    tree.Erase(x);
+                    break;
+                default:
+                    tree.Find(x);
+                    break;
+            }
+            ASSERT_TRUE(builder.GetTreeInfo().node_to_status.empty());
+        }
+        ASSERT_GT(steps, 2000);
+    }
+
+    TEST(Events, RotationsAreReported) {
+        Tree tree;
+        size_t rotations = 0;
+        size_t rotate_statuses = 0;
+        Observer<Event> observer([&](const Event& event) {
+            if (event.type == TreeEventType::rotation) {
+                ++rotations;
+            }
+            if (event.type == TreeEventType::status_changed && event.status == Status::rotate) {
+                ++rotate_statuses;
+            }
+        });
+        tree.SubscribeToEvents(&observer);
+        for (int x = 1; x <= 3; ++x) {
+            tree.Insert(x);
+        }
+        ASSERT_EQ(rotations, 1);
+        ASSERT_GT(rotate_statuses, 0);
+    }
+
+    TEST(Events, NestedStatusesAreRestored) {
+        Tree tree;
+        TreeInfoBuilder<int> builder;
+        // For every step: whether it shows a rotation and whether it shows other statuses
+        std::vector<std::pair<bool, bool>> steps;
+        Observer<Event> observer([&](const Event& event) {
+            if (!builder.Apply(event)) {
+                return;
+            }
+            bool rotate = false;
+            bool other = false;
+            for (const auto& [node, status] : builder.GetTreeInfo().node_to_status) {
+                (status == Status::rotate ? rotate : other) = true;
+            }
+            steps.emplace_back(rotate, other);
+        });
+        tree.Insert(1);
+        tree.Insert(2);
+        tree.SubscribeToEvents(&observer);
+        tree.Insert(3);
+        ASSERT_TRUE(std::find(steps.begin(), steps.end(), std::pair(true, false)) != steps.end());
+        ASSERT_EQ(steps.back(), std::pair(false, true));
+        ASSERT_TRUE(builder.GetTreeInfo().node_to_status.empty());
+    }
+
+    TEST(Events, LateSubscriberGetsTheLastEvent) {
+        Tree tree;
+        for (int x = 1; x <= 10; ++x) {
+            tree.Insert(x);
+        }
+        size_t subscribed = 0;
+        Observer<Event> observer(
+                [&subscribed](const Event& event) {
+                    ++subscribed;
+                    ASSERT_EQ(event.type, TreeEventType::operation_finished);
+                },
+                Observer<Event>::do_nothing, Observer<Event>::do_nothing);
+        tree.SubscribeToEvents(&observer);
+        ASSERT_EQ(subscribed, 1);
+    }
+
+    TEST(Events, FrameRateKeepsKeyFrames) {
+        auto run = [](size_t frames_per_second, Tree* tree) {
+            Picture picture;
+            size_t steps = 0;
+            bool rotation_shown = true;
+            TreeEventType previous = TreeEventType::step;
+            Observer<Event> observer([&](const Event& event) {
+                picture.Apply(event);
+                if (event.type == TreeEventType::rotation) {
+                    // No frame has two rotations
+                    ASSERT_TRUE(rotation_shown);
+                    rotation_shown = false;
+                } else if (event.type == TreeEventType::step) {
+                    rotation_shown = true;
+                    ++steps;
+                } else if (event.type == TreeEventType::operation_finished) {
+                    // The last frame of an operation is delivered
+                    ASSERT_EQ(previous, TreeEventType::step);
+                }
+                previous = event.type;
+            });
+            tree->SetFrameRate(frames_per_second);
+            tree->SubscribeToEvents(&observer);
+            std::mt19937 gen(2);
+            std::uniform_int_distribution<int> value(0, 300);
+            for (int i = 0; i < 3000; ++i) {
+                int x = value(gen);
+                if (gen() % 2) {
+                    tree->Insert(x);
+                } else {
+                    tree->Erase(x);
+                }
+            }
+            std::unordered_set<const Node*> nodes;
+            CollectNodes(tree->Root(), &nodes);
+            EXPECT_EQ(picture.root, tree->Root());
+            for (const Node* node : nodes) {
+                EXPECT_EQ(picture.kids[node].first, node->left);
+                EXPECT_EQ(picture.kids[node].second, node->right);
+                EXPECT_EQ(picture.colors.at(node), node->color);
+            }
+            return steps;
+        };
+        Tree all_frames;
+        size_t all_steps = run(0, &all_frames);
+        ASSERT_EQ(all_frames.DroppedFrames(), 0);
+        ASSERT_EQ(all_frames.MergedFrames(), 0);
+
+        Tree limited;
+        size_t limited_steps = run(1, &limited);
+        ASSERT_LT(limited_steps, all_steps);
+        ASSERT_GT(limited.DroppedFrames(), 0);
+        ASSERT_GT(limited.MergedFrames(), 0);
+        ASSERT_EQ(limited_steps + limited.DroppedFrames() + limited.MergedFrames(), all_steps);
+    }
+
+    TEST(Events, FrameRateHoldsChangesWithTheStep) {
+        FrameLimiter<Event> limiter;
+        limiter.SetFrameRate(1);
+        std::vector<TreeEventType> sent;
+        auto filter = [&limiter, &sent](const Event& event) {
+            limiter.Filter(event, [&sent](const Event& passed) {
+                sent.push_back(passed.type);
+            });
+        };
+        const Node* node = reinterpret_cast<const Node*>(&sent);
+        filter(Event::OperationStarted(nullptr, 0));
+        filter(Event::Recolor(node, Color::red));
+        filter(Event::Step(1));
+        ASSERT_EQ(sent, std::vector<TreeEventType>({TreeEventType::operation_started,
+                                                    TreeEventType::recolor, TreeEventType::step}));
+        // Held back until the end of the operation, together with its changes
+        sent.clear();
+        filter(Event::Recolor(node, Color::black));
+        filter(Event::Step(1));
+        filter(Event::LinkChanged(nullptr, Kid::non, node));
+        filter(Event::Step(1));
+        ASSERT_TRUE(sent.empty());
+        filter(Event::OperationFinished());
+        ASSERT_EQ(sent, std::vector<TreeEventType>(
+                                {TreeEventType::recolor, TreeEventType::link_changed,
+                                 TreeEventType::step, TreeEventType::operation_finished}));
+        ASSERT_EQ(limiter.MergedFrames(), 1);
+    }
+
+    TEST(Events, LogIsReadBack) {
+        std::stringstream log;
+        std::vector<Event> sent;
+        {
+            Tree tree;
+            EventLogWriter<Event> writer(log);
+            Observer<Event> observer([&sent](const Event& event) {
+                sent.push_back(event);
+            });
+            tree.SubscribeToEvents(writer.GetObserver());
+            tree.SubscribeToEvents(&observer);
+            std::mt19937 gen(3);
+            for (int i = 0; i < 300; ++i) {
+                int x = static_cast<int>(gen() % 100) - 50;
+                if (gen() % 3) {
+                    tree.Insert(x);
+                } else {
+                    tree.Erase(x);
+                }
+            }
+            writer.GetObserver()->Unsubscribe();
+            observer.Unsubscribe();
+        }
+        TreeMirror<int> mirror;
+        Event event;
+        size_t read = 0;
+        while (ReadEvent(log, &event)) {
+            ASSERT_LT(read, sent.size());
+            const Event& expected = sent[read++];
+            ASSERT_EQ(event.type, expected.type);
+            ASSERT_EQ(event.node, expected.node);
+            ASSERT_EQ(event.other, expected.other);
+            ASSERT_EQ(event.value, expected.value);
+            mirror.Apply(event);
+        }
+        ASSERT_EQ(read, sent.size());
+        ASSERT_GT(mirror.Size(), 0);
+    }
+
+    TEST(Events, BulkOperationsKeepFollowersInSync) {
+        // Follows a tree through its events, checks they name only the nodes it was sent and
+        // that every frame matches the tree
+        struct Follower {
+            explicit Follower(const Tree* tree)
+                : tree(tree), observer([this](const Event& event) {
+                      bool names_nodes = event.type != TreeEventType::operation_started &&
+                                         event.type != TreeEventType::operation_finished &&
+                                         event.type != TreeEventType::tree_replaced &&
+                                         event.type != TreeEventType::node_created;
+                      for (const Node* node : {event.node, event.other}) {
+                          if (names_nodes && node) {
+                              ASSERT_TRUE(known.contains(node));
+                          }
+                      }
+                      if (event.type == TreeEventType::tree_replaced) {
+                          known.clear();
+                      } else if (event.type == TreeEventType::node_created) {
+                          known.insert(event.node);
+                      } else if (event.type == TreeEventType::node_destroyed) {
+                          known.erase(event.node);
+                      }
+                      layout.Apply(event);
+                      if (mirror.Apply(event)) {
+                          ++frames;
+                          Check();
+                      }
+                  }) {
+            }
+
+            // The tree may be in the middle of an operation, so it is walked from the root
+            void Check() {
+                std::vector<const Node*> nodes;
+                InOrder(tree->Root(), &nodes);
+                ASSERT_EQ(layout.Root(), tree->Root());
+                ASSERT_EQ(mirror.Root(), tree->Root());
+                ASSERT_EQ(layout.Size(), nodes.size());
+                ASSERT_EQ(known.size(), nodes.size());
+                for (size_t i = 0; i < nodes.size(); ++i) {
+                    ASSERT_EQ(layout.GetPlace(nodes[i]).index, i);
+                    const TreeMirror<int>::Node* node = mirror.Find(nodes[i]);
+                    ASSERT_NE(node, nullptr);
+                    ASSERT_EQ(node->value, nodes[i]->value);
+                    ASSERT_EQ(node->color, nodes[i]->color);
+                    ASSERT_EQ(node->left, nodes[i]->left);
+                    ASSERT_EQ(node->right, nodes[i]->right);
+                }
+            }
+
+            static void InOrder(const Node* node, std::vector<const Node*>* nodes) {
+                if (node) {
+                    InOrder(node->left, nodes);
+                    nodes->push_back(node);
+                    InOrder(node->right, nodes);
+                }
+            }
+
+            const Tree* tree;
+            std::unordered_set<const Node*> known;
+            TreeMirror<int> mirror;
+            TreeLayout<int> layout;
+            size_t frames = 0;
+            Observer<Event> observer;
+        };
+        Tree left;
+        Tree right;
+        Follower left_follower(&left);
+        Follower right_follower(&right);
+        left.SubscribeToEvents(&left_follower.observer);
+        right.SubscribeToEvents(&right_follower.observer);
+        for (int i = 0; i < 100; ++i) {
+            left.Insert(i);
+        }
+        for (int i = 101; i < 110; ++i) {
+            right.Insert(i);
+        }
+        size_t frames = left_follower.frames;
+        left.Join(100, right);
+        // The fixup is shown step by step
+        ASSERT_GT(left_follower.frames, frames + 1);
+        left.Split(30, right);
+        left_follower.Check();
+        right_follower.Check();
+        right.Erase(right.LowerBound(40), right.LowerBound(90));
+        right_follower.Check();
+        left.Insert(200);
+        left_follower.Check();
+
+        // Even values only, so an odd pivot fits between the halves
+        left.Clear();
+        right.Clear();
+        std::mt19937 gen(4);
+        for (int i = 0; i < 200; ++i) {
+            left.Insert(2 * static_cast<int>(gen() % 300));
+            int key = 2 * static_cast<int>(gen() % 300);
+            left.Split(key, right);
+            if (right.Size() > 2 && gen() % 2 == 0) {
+                right.Erase(std::next(right.begin()), std::prev(right.end()));
+            }
+            left.Join(key + 1, right);
+            ASSERT_TRUE(right.Empty());
+            left.Erase(key + 1);
+        }
+        left_follower.Check();
+        right_follower.Check();
+    }
+}// namespace DSVisualization
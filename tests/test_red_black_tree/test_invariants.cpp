@@ -3,8 +3,10 @@
 
 #include "../../red_black_tree.h"
 
+#include <algorithm>
 #include <numeric>
 #include <random>
+#include <set>
 
 #include <gtest/gtest.h>
 
@@ -75,4 +77,149 @@ namespace DSVisualization {
             }
         }
     }
+
+    TEST(Invariants, BuildFromSorted) {
+        for (int size = 0; size <= 600; ++size) {
+            std::vector<int> values(size);
+            std::iota(values.begin(), values.end(), 1);
+            std::transform(values.begin(), values.end(), values.begin(), [](int x) {
+                return 2 * x;
+            });
+            RedBlackTree<int> rb_tree(values.begin(), values.end());
+            ASSERT_TRUE(rb_tree.CheckInvariants());
+            ASSERT_EQ(rb_tree.Size(), values.size());
+            std::vector<int> tree_values;
+            for (int x : rb_tree) {
+                tree_values.push_back(x);
+            }
+            ASSERT_TRUE(values == tree_values);
+            for (int x = 1; x <= 2 * size + 1; x += 2) {
+                ASSERT_TRUE(rb_tree.Insert(x));
+                ASSERT_TRUE(rb_tree.CheckInvariants());
+            }
+            rb_tree.BuildFromSorted(values.begin(), values.end());
+            ASSERT_TRUE(rb_tree.CheckInvariants());
+            for (int x : values) {
+                ASSERT_TRUE(rb_tree.Erase(x));
+                ASSERT_TRUE(rb_tree.CheckInvariants());
+            }
+            ASSERT_TRUE(rb_tree.Empty());
+        }
+    }
+
+    TEST(Invariants, JoinSplit) {
+        for (int test = 1; test <= 300; ++test) {
+            std::mt19937 rnd(test);
+            std::uniform_int_distribution<> uid(0, 300);
+            int left_size = uid(rnd);
+            int right_size = uid(rnd);
+            RedBlackTree<int> left;
+            RedBlackTree<int> right;
+            std::vector<int> left_values(left_size);
+            std::iota(left_values.begin(), left_values.end(), 0);
+            std::shuffle(left_values.begin(), left_values.end(), rnd);
+            for (int x : left_values) {
+                left.Insert(x);
+            }
+            for (int x = 1; x <= right_size; ++x) {
+                right.Insert(left_size + x);
+            }
+            RedBlackTree<int> joined;
+            joined.Join(left, left_size, right);
+            ASSERT_TRUE(left.Empty());
+            ASSERT_TRUE(right.Empty());
+            ASSERT_TRUE(joined.CheckInvariants());
+            ASSERT_EQ(joined.Size(), left_size + right_size + 1);
+            int expected = 0;
+            for (int x : joined) {
+                ASSERT_EQ(x, expected++);
+            }
+
+            for (int split_test = 0; split_test < 5; ++split_test) {
+                int key = uid(rnd) * (left_size + right_size + 2) / 300 - 1;
+                RedBlackTree<int> greater;
+                joined.Split(key, greater);
+                ASSERT_TRUE(joined.CheckInvariants());
+                ASSERT_TRUE(greater.CheckInvariants());
+                int expected_less = std::clamp(key + 1, 0, left_size + right_size + 1);
+                ASSERT_EQ(joined.Size(), expected_less);
+                ASSERT_EQ(greater.Size(), left_size + right_size + 1 - expected_less);
+                expected = 0;
+                for (int x : joined) {
+                    ASSERT_EQ(x, expected++);
+                }
+                for (int x : greater) {
+                    ASSERT_EQ(x, expected++);
+                }
+                if (greater.Empty()) {
+                    continue;
+                }
+                int pivot = *greater.begin();
+                greater.Erase(pivot);
+                joined.Join(pivot, greater);
+                ASSERT_TRUE(joined.CheckInvariants());
+                ASSERT_EQ(joined.Size(), left_size + right_size + 1);
+            }
+        }
+    }
+
+    TEST(Invariants, HintedInsert) {
+        for (int test = 1; test <= 100; ++test) {
+            std::mt19937 rnd(test);
+            std::uniform_int_distribution<> uid(1, 1000);
+            RedBlackTree<int, NoTracing> rb_tree;
+            std::set<int> s;
+            for (int step = 1; step <= 300; ++step) {
+                int value = uid(rnd);
+                // Correct hints most of the time, arbitrary ones otherwise
+                auto hint = (uid(rnd) % 4 ? rb_tree.LowerBound(value)
+                                          : rb_tree.LowerBound(uid(rnd)));
+                auto it = rb_tree.Insert(hint, value);
+                s.insert(value);
+                ASSERT_EQ(*it, value);
+                ASSERT_TRUE(rb_tree.CheckInvariants());
+            }
+            ASSERT_TRUE(std::equal(rb_tree.begin(), rb_tree.end(), s.begin(), s.end()));
+        }
+        RedBlackTree<int, NoTracing> rb_tree;
+        for (int value = 1; value <= 1000; ++value) {
+            rb_tree.Insert(rb_tree.end(), value);
+        }
+        ASSERT_TRUE(rb_tree.CheckInvariants());
+        ASSERT_EQ(rb_tree.Size(), 1000);
+    }
+
+    TEST(Invariants, EraseByIterator) {
+        for (int test = 1; test <= 100; ++test) {
+            std::mt19937 rnd(test);
+            std::uniform_int_distribution<> uid(0, 299);
+            std::vector<int> values(300);
+            std::iota(values.begin(), values.end(), 0);
+            RedBlackTree<int> rb_tree(values.begin(), values.end());
+            std::set<int> s(values.begin(), values.end());
+            for (int step = 1; step <= 10 && !s.empty(); ++step) {
+                int lo = uid(rnd);
+                int hi = lo + uid(rnd) % 40;
+                auto it = rb_tree.end();
+                auto s_it = s.end();
+                if (step % 3 == 0 && s.lower_bound(lo) != s.end()) {
+                    it = rb_tree.Erase(rb_tree.LowerBound(lo));
+                    s_it = s.erase(s.lower_bound(lo));
+                } else {
+                    it = rb_tree.Erase(rb_tree.LowerBound(lo), rb_tree.LowerBound(hi));
+                    s_it = s.erase(s.lower_bound(lo), s.lower_bound(hi));
+                }
+                ASSERT_TRUE(rb_tree.CheckInvariants());
+                ASSERT_EQ(rb_tree.Size(), s.size());
+                ASSERT_TRUE(std::equal(rb_tree.begin(), rb_tree.end(), s.begin(), s.end()));
+                ASSERT_EQ(it == rb_tree.end(), s_it == s.end());
+                if (it != rb_tree.end()) {
+                    ASSERT_EQ(*it, *s_it);
+                }
+            }
+            rb_tree.Erase(rb_tree.begin(), rb_tree.end());
+            ASSERT_TRUE(rb_tree.Empty());
+            ASSERT_TRUE(rb_tree.CheckInvariants());
+        }
+    }
 }// namespace DSVisualization
@@ -0,0 +1,90 @@
+#include "../../red_black_map.h"
+#include "../../red_black_tree.h"
+
+#include <iterator>
+#include <random>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace DSVisualization {
+    namespace {
+        using Tree = RedBlackTree<int32_t, NoTracing>;
+
+        static_assert(std::bidirectional_iterator<Tree::Iterator>);
+        static_assert(std::bidirectional_iterator<Tree::ConstIterator>);
+        static_assert(std::is_convertible_v<Tree::Iterator, Tree::ConstIterator>);
+        static_assert(!std::is_convertible_v<Tree::ConstIterator, Tree::Iterator>);
+    }// namespace
+
+    TEST(Iterators, RandomTestsBidirectional) {
+        for (int test = 1; test <= 100; ++test) {
+            std::mt19937 rnd(test);
+            std::uniform_int_distribution<> uid(1, 100);
+            Tree rb_tree;
+            std::set<int32_t> s;
+            for (int step = 1; step <= 300; ++step) {
+                int32_t value = uid(rnd);
+                if (uid(rnd) % 3) {
+                    rb_tree.Insert(value);
+                    s.insert(value);
+                } else {
+                    rb_tree.Erase(value);
+                    s.erase(value);
+                }
+                ASSERT_TRUE(std::vector<int32_t>(rb_tree.rbegin(), rb_tree.rend()) ==
+                            std::vector<int32_t>(s.rbegin(), s.rend()));
+                if (!s.empty()) {
+                    ASSERT_EQ(*rb_tree.begin(), *s.begin());
+                    ASSERT_EQ(*std::prev(rb_tree.end()), *s.rbegin());
+                }
+                int32_t key = uid(rnd);
+                auto lower = rb_tree.LowerBound(key);
+                auto upper = rb_tree.UpperBound(key);
+                ASSERT_EQ(std::distance(rb_tree.begin(), lower),
+                          std::distance(s.begin(), s.lower_bound(key)));
+                ASSERT_EQ(std::distance(rb_tree.begin(), upper),
+                          std::distance(s.begin(), s.upper_bound(key)));
+                auto [first, last] = rb_tree.EqualRange(key);
+                ASSERT_TRUE(first == lower && last == upper);
+                ASSERT_EQ(std::distance(first, last), static_cast<int32_t>(s.count(key)));
+            }
+        }
+    }
+
+    TEST(Iterators, ScanFromTheMiddle) {
+        std::vector<int32_t> values(100);
+        for (int32_t i = 0; i < 100; ++i) {
+            values[i] = i * 2;
+        }
+        const Tree rb_tree(values.begin(), values.end());
+        std::vector<int32_t> scanned(rb_tree.LowerBound(41), rb_tree.UpperBound(60));
+        ASSERT_TRUE(scanned == std::vector<int32_t>({42, 44, 46, 48, 50, 52, 54, 56, 58, 60}));
+        auto it = rb_tree.Select(50);
+        ASSERT_EQ(*it--, 100);
+        ASSERT_EQ(*it++, 98);
+        ASSERT_EQ(*++it, 102);
+        ASSERT_TRUE(rb_tree.LowerBound(1000) == rb_tree.end());
+        ASSERT_TRUE(rb_tree.UpperBound(-1) == rb_tree.begin());
+    }
+
+    TEST(Iterators, MapValuesAreMutable) {
+        RedBlackMap<std::string, int32_t, std::less<>, NoTracing> map;
+        for (int32_t i = 0; i < 10; ++i) {
+            map.Emplace(std::to_string(i), i);
+        }
+        for (auto it = map.LowerBound(std::string_view("5")); it != map.end(); ++it) {
+            it->second *= 10;
+        }
+        int32_t expected = 9;
+        for (auto it = map.rbegin(); it != map.rend(); ++it, --expected) {
+            ASSERT_EQ(it->second, expected < 5 ? expected : expected * 10);
+        }
+        auto [first, last] = map.EqualRange(std::string_view("3"));
+        ASSERT_EQ(first->second, 3);
+        ASSERT_TRUE(++first == last);
+    }
+}// namespace DSVisualization
@@ -0,0 +1,139 @@
+#include "../../red_black_map.h"
+
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+
+#include <gtest/gtest.h>
+
+namespace DSVisualization {
+    namespace {
+        // Counts the copies, so the tests can check that the payload is only moved
+        struct Payload {
+            explicit Payload(int value) : value(value) {
+            }
+
+            Payload(const Payload& other) : value(other.value) {
+                ++copies;
+            }
+
+            Payload(Payload&& other) noexcept : value(other.value) {
+            }
+
+            int value;
+            static inline int copies = 0;
+        };
+
+        struct Greater {
+            bool operator()(int lhs, int rhs) const {
+                return lhs > rhs;
+            }
+        };
+
+        // The order is chosen at construction, so a default constructed one differs
+        struct Reversible {
+            bool operator()(int lhs, int rhs) const {
+                return reverse ? lhs > rhs : lhs < rhs;
+            }
+
+            bool reverse = false;
+        };
+    }// namespace
+
+    TEST(Map, HeterogeneousLookup) {
+        RedBlackMap<std::string, int, std::less<>, NoTracing> map;
+        ASSERT_TRUE(map.Emplace("one", 1));
+        ASSERT_TRUE(map.Insert({"two", 2}));
+        ASSERT_FALSE(map.Emplace("one", 3));
+        std::string_view key = "one";
+        ASSERT_TRUE(map.Find(key));
+        ASSERT_TRUE(map.Find("two"));
+        ASSERT_FALSE(map.Find(std::string_view("three")));
+        ASSERT_EQ(*map.Get(key), 1);
+        *map.Get("two") = 20;
+        ASSERT_EQ(*map.Get(std::string("two")), 20);
+        ASSERT_TRUE(map.Erase(key));
+        ASSERT_FALSE(map.Find("one"));
+        ASSERT_EQ(map.Size(), 1);
+    }
+
+    TEST(Map, CustomCompare) {
+        RedBlackMap<int, int, Greater, NoTracing> map;
+        for (int i = 0; i < 10; ++i) {
+            map.Emplace(i, i * i);
+        }
+        int expected = 9;
+        for (const auto& [key, value] : map) {
+            ASSERT_EQ(key, expected);
+            ASSERT_EQ(value, expected * expected);
+            --expected;
+        }
+        ASSERT_EQ(*map.Get(3), 9);
+    }
+
+    TEST(Map, StatefulCompare) {
+        RedBlackMap<int, int, Reversible, NoTracing> map(Reversible{true});
+        for (int i = 1; i <= 3; ++i) {
+            map.Emplace(i, i * 10);
+        }
+        ASSERT_EQ(map.begin()->first, 3);
+        for (int i = 1; i <= 3; ++i) {
+            ASSERT_NE(map.Get(i), nullptr);
+            ASSERT_EQ(*map.Get(i), i * 10);
+        }
+        ASSERT_EQ(map.Get(0), nullptr);
+        ASSERT_EQ(map.Get(4), nullptr);
+    }
+
+    TEST(Map, PayloadIsNeverCopied) {
+        Payload::copies = 0;
+        RedBlackMap<int, Payload, std::less<>, NoTracing> map;
+        for (int i = 0; i < 100; ++i) {
+            map.Emplace(i, i);
+            map.Insert({i + 100, Payload(i)});
+        }
+        RedBlackTree<Payload, NoTracing, std::allocator<Payload>, NoAugmentation,
+                     decltype([](const Payload& lhs, const Payload& rhs) {
+                         return lhs.value < rhs.value;
+                     })>
+                tree;
+        for (int i = 0; i < 100; ++i) {
+            tree.Insert(Payload(i));
+        }
+        for (int i = 0; i < 200; i += 2) {
+            ASSERT_TRUE(map.Erase(i));
+        }
+        for (int i = 0; i < 100; i += 2) {
+            ASSERT_TRUE(tree.Erase(Payload(i)));
+        }
+        ASSERT_EQ(Payload::copies, 0);
+        ASSERT_EQ(map.Size(), 100);
+        ASSERT_EQ(tree.Size(), 50);
+    }
+
+    TEST(Map, RandomTestsInsertErase) {
+        for (int test = 1; test <= 100; ++test) {
+            std::mt19937 rnd(test);
+            std::uniform_int_distribution<> uid(1, 100);
+            RedBlackMap<std::string, int, std::less<>, NoTracing> map;
+            std::map<std::string, int, std::less<>> expected;
+            for (int step = 1; step <= 300; ++step) {
+                std::string key = std::to_string(uid(rnd));
+                int value = uid(rnd);
+                if (uid(rnd) % 3) {
+                    ASSERT_EQ(map.Emplace(key, value), expected.emplace(key, value).second);
+                } else {
+                    ASSERT_EQ(map.Erase(std::string_view(key)), expected.erase(key) == 1);
+                }
+                ASSERT_EQ(map.Size(), expected.size());
+            }
+            auto it = expected.begin();
+            for (const auto& entry : map) {
+                ASSERT_EQ(entry, *it);
+                ++it;
+            }
+        }
+    }
+}// namespace DSVisualization
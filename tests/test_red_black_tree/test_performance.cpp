@@ -1,16 +1,137 @@
 #define NO_LOGGING
+#include "../../compact_red_black_tree.h"
+#include "../../pool_allocator.h"
 #include "../../red_black_tree.h"
 #include "../../time_wrapper.h"
 
+#include <algorithm>
 #include <iomanip>
+#include <memory>
+#include <numeric>
+#include <random>
 #include <set>
 
 #include <gtest/gtest.h>
 
 namespace DSVisualization {
+    namespace {
+        // The memory a tree holds for its nodes
+        struct Footprint {
+            size_t blocks = 0;
+            size_t bytes = 0;
+        };
+
+        // std::allocator which keeps the footprint of the blocks it handed out. The heap adds
+        // its own header and rounding to every block, which only the number of blocks shows.
+        template<typename T>
+        class CountingAllocator {
+            template<typename U>
+            friend class CountingAllocator;
+
+        public:
+            using value_type = T;
+
+            explicit CountingAllocator(Footprint* footprint) : footprint_(footprint) {
+            }
+
+            template<typename U>
+            CountingAllocator(const CountingAllocator<U>& other) : footprint_(other.footprint_) {
+            }
+
+            T* allocate(size_t n) {
+                ++footprint_->blocks;
+                footprint_->bytes += n * sizeof(T);
+                return std::allocator<T>().allocate(n);
+            }
+
+            void deallocate(T* ptr, size_t n) {
+                --footprint_->blocks;
+                footprint_->bytes -= n * sizeof(T);
+                std::allocator<T>().deallocate(ptr, n);
+            }
+
+            template<typename U>
+            bool operator==(const CountingAllocator<U>& other) const {
+                return footprint_ == other.footprint_;
+            }
+
+        private:
+            Footprint* footprint_;
+        };
+
+        // Inserts 1..n in increasing order and erases them again
+        template<typename InsertErase>
+        void ReportLinear(const std::string& name, InsertErase insert_erase, int n) {
+            clock_t time = 0;
+            TestTime(insert_erase, time).call(n);
+            std::cout << name << ": " << std::fixed << std::setprecision(6)
+                      << static_cast<double>(time) / CLOCKS_PER_SEC << " s\n";
+        }
+
+        // The footprint is taken when all the values are inserted
+        template<typename Tree, typename MeasureFootprint>
+        void ReportInsertErase(const std::string& name, const std::vector<int32_t>& values,
+                               Tree* rb_tree, MeasureFootprint measure_footprint) {
+            clock_t insert_time = 0;
+            clock_t erase_time = 0;
+            TestTime(
+                    [rb_tree, &values]() {
+                        for (int32_t value : values) {
+                            rb_tree->Insert(value);
+                        }
+                    },
+                    insert_time)
+                    .call();
+            Footprint footprint = measure_footprint();
+            TestTime(
+                    [rb_tree, &values]() {
+                        for (int32_t value : values) {
+                            rb_tree->Erase(value);
+                        }
+                    },
+                    erase_time)
+                    .call();
+            auto per_second = [&values](clock_t time) {
+                return static_cast<double>(values.size()) * CLOCKS_PER_SEC /
+                       static_cast<double>(std::max<clock_t>(time, 1));
+            };
+            std::cout << name << ": insert " << std::fixed << std::setprecision(0)
+                      << per_second(insert_time) << " ops/s, erase " << per_second(erase_time)
+                      << " ops/s, " << footprint.bytes / 1024 << " kB in " << footprint.blocks
+                      << " blocks\n";
+        }
+
+        template<typename Tree>
+        void ReportFind(const std::string& name, const std::vector<int32_t>& values) {
+            Tree rb_tree;
+            for (int32_t value : values) {
+                rb_tree.Insert(value);
+            }
+            std::vector<int32_t> queries(values.size());
+            std::uniform_int_distribution<int32_t> uid(1, 2 * static_cast<int32_t>(values.size()));
+            std::mt19937 rnd(1);
+            std::generate(queries.begin(), queries.end(), [&uid, &rnd]() {
+                return uid(rnd);
+            });
+            clock_t time = 0;
+            size_t found = 0;
+            TestTime(
+                    [&rb_tree, &queries, &found]() {
+                        for (int32_t query : queries) {
+                            found += rb_tree.Find(query);
+                        }
+                    },
+                    time)
+                    .call();
+            std::cout << name << ": " << std::fixed << std::setprecision(0)
+                      << static_cast<double>(queries.size()) * CLOCKS_PER_SEC /
+                                 static_cast<double>(std::max<clock_t>(time, 1))
+                      << " finds/s (" << found << " found)\n";
+        }
+    }// namespace
 
     TEST(Performance, Linear) {
-        auto foo1 = [](int n) {
+        auto traced = [](int n) {
             RedBlackTree<int32_t> rb_tree;
             for (int i = 1; i <= n; ++i) {
                 rb_tree.Insert(i);
@@ -19,26 +140,104 @@ namespace DSVisualization {
                 rb_tree.Erase(i);
             }
         };
-        for (int n : {10, 1'000, 200'000, 1'000'000}) {
-            clock_t time = 0;
-            TestTime(foo1, time).call(n);
-            std::cout << "n = " << n << ": " << time / CLOCKS_PER_SEC << "." << std::setw(6)
-                      << std::setfill('0') << time % CLOCKS_PER_SEC << "\n";
-        }
-        auto foo2 = [](int n) {
-            std::set<int32_t> rb_tree;
+        auto untraced = [](int n) {
+            RedBlackTree<int32_t, NoTracing> rb_tree;
+            for (int i = 1; i <= n; ++i) {
+                rb_tree.Insert(i);
+            }
+            for (int i = 1; i <= n; ++i) {
+                rb_tree.Erase(i);
+            }
+        };
+        auto hinted = [](int n) {
+            RedBlackTree<int32_t, NoTracing> rb_tree;
+            for (int i = 1; i <= n; ++i) {
+                rb_tree.Insert(rb_tree.end(), i);
+            }
+            while (!rb_tree.Empty()) {
+                rb_tree.Erase(rb_tree.begin());
+            }
+        };
+        auto std_set = [](int n) {
+            std::set<int32_t> set;
             for (int i = 1; i <= n; ++i) {
-                rb_tree.insert(i);
+                set.insert(i);
             }
             for (int i = 1; i <= n; ++i) {
-                rb_tree.erase(i);
+                set.erase(i);
             }
         };
         for (int n : {10, 1'000, 200'000, 1'000'000}) {
-            clock_t time = 0;
-            TestTime(foo2, time).call(n);
-            std::cout << "n = " << n << ": " << time / CLOCKS_PER_SEC << "." << std::setw(6)
-                      << std::setfill('0') << time % CLOCKS_PER_SEC << "\n";
+            std::cout << "n = " << n << "\n";
+            ReportLinear("  RedBlackTree                  ", traced, n);
+            ReportLinear("  RedBlackTree (NoTracing)      ", untraced, n);
+            ReportLinear("  RedBlackTree (NoTracing, hint)", hinted, n);
+            ReportLinear("  std::set                      ", std_set, n);
+        }
+    }
+
+    TEST(Performance, Allocator) {
+        using CountedTree = RedBlackTree<int32_t, NoTracing, CountingAllocator<int32_t>>;
+        using PoolTree = RedBlackTree<int32_t, NoTracing, PoolAllocator<int32_t>>;
+        const int32_t n = 1'000'000;
+        std::vector<int32_t> values(n);
+        std::iota(values.begin(), values.end(), 1);
+        for (bool shuffled : {false, true}) {
+            if (shuffled) {
+                std::shuffle(values.begin(), values.end(), std::mt19937(n));
+            }
+            std::cout << (shuffled ? "shuffled" : "linear") << ", n = " << n << "\n";
+            Footprint counted;
+            CountedTree counted_tree{CountingAllocator<int32_t>(&counted)};
+            ReportInsertErase("  std::allocator", values, &counted_tree, [&counted]() {
+                return counted;
+            });
+            PoolTree pool_tree;
+            ReportInsertErase("  PoolAllocator ", values, &pool_tree, [&pool_tree]() {
+                size_t slabs = pool_tree.GetAllocator().Pool().SlabCount();
+                return Footprint{slabs, slabs * BlockPool::default_blocks_per_slab *
+                                                sizeof(PoolTree::Node)};
+            });
+        }
+    }
+
+    TEST(Performance, Find) {
+        for (int32_t n : {10'000, 1'000'000}) {
+            std::vector<int32_t> values(n);
+            std::iota(values.begin(), values.end(), 1);
+            std::shuffle(values.begin(), values.end(), std::mt19937(n));
+            std::cout << "n = " << n << "\n";
+            ReportFind<RedBlackTree<int32_t, NoTracing>>("  RedBlackTree       ", values);
+            ReportFind<RedBlackTree<int32_t, NoTracing, PoolAllocator<int32_t>>>(
+                    "  RedBlackTree (pool)", values);
+            ReportFind<CompactRedBlackTree<int32_t>>("  CompactRedBlackTree", values);
+        }
+    }
+
+    TEST(Performance, BuildFromSorted) {
+        for (int32_t n : {1'000, 200'000, 1'000'000}) {
+            std::vector<int32_t> values(n);
+            std::iota(values.begin(), values.end(), 1);
+            clock_t insert_time = 0;
+            clock_t build_time = 0;
+            TestTime(
+                    [&values]() {
+                        RedBlackTree<int32_t> rb_tree;
+                        for (int32_t value : values) {
+                            rb_tree.Insert(value);
+                        }
+                    },
+                    insert_time)
+                    .call();
+            TestTime(
+                    [&values]() {
+                        RedBlackTree<int32_t> rb_tree(values.begin(), values.end());
+                    },
+                    build_time)
+                    .call();
+            std::cout << "n = " << n << ": Insert " << std::fixed << std::setprecision(6)
+                      << static_cast<double>(insert_time) / CLOCKS_PER_SEC << " s, BuildFromSorted "
+                      << static_cast<double>(build_time) / CLOCKS_PER_SEC << " s\n";
         }
     }
 }// namespace DSVisualization
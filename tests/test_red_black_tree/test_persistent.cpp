@@ -0,0 +1,163 @@
+#define INVARIANTS_CHECK
+#define NO_LOGGING
+
+#include "../../persistent_red_black_tree.h"
+
+#include <atomic>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace DSVisualization {
+    namespace {
+        // Counts the nodes alive, so that the tests can check that the versions share them
+        // and free them
+        template<typename T>
+        struct CountingAllocator {
+            using value_type = T;
+
+            CountingAllocator() = default;
+
+            template<typename U>
+            CountingAllocator(const CountingAllocator<U>&) {
+            }
+
+            T* allocate(size_t n) {
+                allocated += n;
+                return std::allocator<T>().allocate(n);
+            }
+
+            void deallocate(T* ptr, size_t n) {
+                allocated -= n;
+                std::allocator<T>().deallocate(ptr, n);
+            }
+
+            template<typename U>
+            bool operator==(const CountingAllocator<U>&) const {
+                return true;
+            }
+
+            static inline std::atomic<int64_t> allocated = 0;
+        };
+
+        using Tree = PersistentRedBlackTree<int, std::less<int>, CountingAllocator<int>>;
+        using Allocated = CountingAllocator<Tree::Node>;
+    }// namespace
+
+    TEST(Persistent, RandomTestsInsertErase) {
+        for (int test = 1; test <= 100; ++test) {
+            std::mt19937 rnd(test);
+            std::uniform_int_distribution<> uid(1, 100);
+            Tree tree;
+            std::set<int> s;
+            for (int step = 1; step <= 500; ++step) {
+                int value = uid(rnd);
+                if (uid(rnd) % 3) {
+                    ASSERT_EQ(tree.Insert(value), s.insert(value).second);
+                } else {
+                    ASSERT_EQ(tree.Erase(value), s.erase(value) == 1);
+                }
+                ASSERT_TRUE(tree.CheckInvariants());
+                ASSERT_EQ(tree.Size(), s.size());
+                ASSERT_TRUE(std::equal(tree.begin(), tree.end(), s.begin(), s.end()));
+            }
+        }
+        ASSERT_EQ(Allocated::allocated, 0);
+    }
+
+    TEST(Persistent, SnapshotsStayUnchanged) {
+        std::mt19937 rnd(1);
+        std::uniform_int_distribution<> uid(1, 1000);
+        Tree tree;
+        std::set<int> s;
+        std::vector<std::pair<Tree::Version, std::set<int>>> history;
+        for (int step = 1; step <= 2000; ++step) {
+            int value = uid(rnd);
+            if (uid(rnd) % 3) {
+                tree.Insert(value);
+                s.insert(value);
+            } else {
+                tree.Erase(value);
+                s.erase(value);
+            }
+            if (step % 100 == 0) {
+                history.emplace_back(tree.Snapshot(), s);
+            }
+        }
+        for (const auto& [version, values] : history) {
+            ASSERT_TRUE(version.CheckInvariants());
+            ASSERT_TRUE(std::equal(version.begin(), version.end(), values.begin(), values.end()));
+        }
+        // Versions share all the nodes but the copied paths
+        ASSERT_LT(Allocated::allocated, static_cast<int64_t>(history.size() * s.size()));
+        tree.Restore(history.front().first);
+        ASSERT_TRUE(std::equal(tree.begin(), tree.end(), history.front().second.begin(),
+                               history.front().second.end()));
+        history.clear();
+        tree.Clear();
+        ASSERT_EQ(Allocated::allocated, 0);
+    }
+
+    TEST(Persistent, TreeInfoHoldsTheVersion) {
+        Tree::Data tree_info;
+        {
+            Tree tree;
+            for (int i = 1; i <= 100; ++i) {
+                tree.Insert(i);
+            }
+            tree_info = tree.Snapshot().GetTreeInfo();
+            for (int i = 1; i <= 100; ++i) {
+                tree.Erase(i);
+            }
+        }
+        ASSERT_EQ(tree_info.tree_size, 100);
+        ASSERT_EQ(tree_info.root->size, 100);
+        tree_info = {};
+        ASSERT_EQ(Allocated::allocated, 0);
+    }
+
+    TEST(Persistent, ReadersDontBlockTheWriter) {
+        Tree tree;
+        std::atomic<bool> done = false;
+        std::vector<std::thread> readers;
+        std::vector<Tree::Version> versions(4);
+        for (int i = 1; i <= 1000; ++i) {
+            tree.Insert(i);
+        }
+        for (Tree::Version& version : versions) {
+            version = tree.Snapshot();
+        }
+        for (Tree::Version& version : versions) {
+            readers.emplace_back([&done, version = std::move(version)]() mutable {
+                while (!done) {
+                    int64_t sum = 0;
+                    for (int value : version) {
+                        sum += value;
+                    }
+                    EXPECT_EQ(sum, 500500);
+                }
+                version = Tree::Version();
+            });
+        }
+        std::mt19937 rnd(1);
+        std::uniform_int_distribution<> uid(1, 2000);
+        for (int step = 1; step <= 100'000; ++step) {
+            int value = uid(rnd);
+            if (step % 2) {
+                tree.Insert(value);
+            } else {
+                tree.Erase(value);
+            }
+        }
+        done = true;
+        for (std::thread& reader : readers) {
+            reader.join();
+        }
+        ASSERT_TRUE(tree.CheckInvariants());
+        tree.Clear();
+        ASSERT_EQ(Allocated::allocated, 0);
+    }
+}// namespace DSVisualization
@@ -0,0 +1,274 @@
+#include "../../event_pipeline.h"
+#include "../../layout_worker.h"
+#include "../../red_black_tree.h"
+#include "../../tree_layout.h"
+#include "../../tree_mirror.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace DSVisualization {
+    namespace {
+        using Tree = RedBlackTree<int>;
+        using Node = Tree::Node;
+        using Event = Tree::Event;
+        using Layout = TreeLayout<int>;
+
+        // Checks the places against the tree itself, returns the size of the subtree
+        size_t CheckPlaces(const Layout& layout, const Node* node, size_t depth, size_t* index) {
+            if (!node) {
+                return 0;
+            }
+            size_t size = CheckPlaces(layout, node->left, depth + 1, index);
+            const Layout::Place& place = layout.GetPlace(node);
+            EXPECT_EQ(place.index, *index);
+            EXPECT_EQ(place.depth, depth);
+            ++*index;
+            size += 1 + CheckPlaces(layout, node->right, depth + 1, index);
+            EXPECT_EQ(place.subtree_size, size);
+            return size;
+        }
+
+        void RunRandomQueries(Tree* tree, int queries_count, int max_value, unsigned seed) {
+            std::mt19937 gen(seed);
+            std::uniform_int_distribution<int> value(0, max_value);
+            for (int i = 0; i < queries_count; ++i) {
+                int x = value(gen);
+                switch (gen() % 3) {
+                    case 0:
+                        tree->Insert(x);
+                        break;
+                    case 1:
+                        tree->Erase(x);
+                        break;
+                    default:
+                        tree->Find(x);
+                        break;
+                }
+            }
+        }
+
+        // The values in the columns the layout gives them
+        struct ValuesFrame {
+            std::vector<int> values;
+        };
+
+        void BuildValuesFrame(const TreeMirror<int>& mirror, const Layout& layout,
+                              ValuesFrame* frame) {
+            frame->values.assign(layout.Size(), 0);
+            std::vector<Layout::NodeId> stack;
+            if (mirror.Root()) {
+                stack.push_back(mirror.Root());
+            }
+            while (!stack.empty()) {
+                Layout::NodeId id = stack.back();
+                stack.pop_back();
+                const TreeMirror<int>::Node* node = mirror.Find(id);
+                frame->values[layout.GetPlace(id).index] = node->value;
+                for (Layout::NodeId kid : {node->left, node->right}) {
+                    if (kid) {
+                        stack.push_back(kid);
+                    }
+                }
+            }
+        }
+
+        void WaitForFrames(const std::atomic<size_t>& ready_frames, size_t count) {
+            while (ready_frames.load() < count) {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        }
+    }// namespace
+
+    TEST(TreeLayout, EveryFrameIsLaidOut) {
+        Tree tree;
+        Layout layout;
+        size_t frames = 0;
+        Observer<Event> observer([&](const Event& event) {
+            if (!layout.Apply(event)) {
+                return;
+            }
+            ++frames;
+            ASSERT_EQ(layout.Root(), tree.Root());
+            size_t index = 0;
+            // The size of the tree itself changes between the frames of an insert or erase
+            ASSERT_EQ(layout.Size(), CheckPlaces(layout, tree.Root(), 0, &index));
+        });
+        tree.SubscribeToEvents(&observer);
+        RunRandomQueries(&tree, 3000, 200, 1);
+        std::vector<int> values(100);
+        std::iota(values.begin(), values.end(), 0);
+        tree.BuildFromSorted(values.begin(), values.end());
+        RunRandomQueries(&tree, 1000, 200, 2);
+        ASSERT_GT(frames, 3000);
+    }
+
+    TEST(TreeLayout, UpdatesAreLocal) {
+        Tree tree;
+        Layout layout;
+        size_t max_update = 0;
+        Observer<Event> observer([&](const Event& event) {
+            if (layout.Apply(event)) {
+                max_update = std::max(max_update, layout.LastUpdateLength());
+            }
+        });
+        tree.SubscribeToEvents(&observer);
+        std::vector<int> values(1000);
+        std::iota(values.begin(), values.end(), 0);
+        tree.BuildFromSorted(values.begin(), values.end());
+        ASSERT_EQ(layout.LastUpdateLength(), 1000);
+
+        max_update = 0;
+        tree.Find(500);
+        ASSERT_EQ(max_update, 0);
+        tree.Insert(1000);
+        ASSERT_LT(max_update, 10);
+        tree.Insert(-1);
+        ASSERT_GE(max_update, 1000);
+    }
+
+    TEST(TreeLayout, UnknownNodesAreSkipped) {
+        Tree tree;
+        Layout layout;
+        Observer<Event> observer([&layout](const Event& event) {
+            layout.Apply(event);
+        });
+        tree.SubscribeToEvents(&observer);
+        for (int i = 0; i < 20; ++i) {
+            tree.Insert(i);
+        }
+        Node unknown(nullptr, Color::red, 100);
+        layout.Apply(Event::LinkChanged(tree.Root(), Kid::left, &unknown));
+        layout.Apply(Event::LinkChanged(&unknown, Kid::right, tree.Root()));
+        layout.Apply(Event::Step(tree.Size()));
+        ASSERT_EQ(layout.Root(), tree.Root());
+        size_t index = 0;
+        ASSERT_EQ(layout.Size(), CheckPlaces(layout, tree.Root(), 0, &index));
+        ASSERT_EQ(layout.Size(), tree.Size());
+    }
+
+    TEST(TreeLayout, FrameTimes) {
+        using Clock = std::chrono::steady_clock;
+        for (int n : {10'000, 100'000}) {
+            Tree tree;
+            Layout incremental;
+            Layout full;
+            std::vector<double> incremental_times;
+            std::vector<double> full_times;
+            size_t updated = 0;
+            Observer<Event> observer([&](const Event& event) {
+                if (event.type != TreeEventType::step) {
+                    incremental.Apply(event);
+                    full.Apply(event);
+                    return;
+                }
+                auto start = Clock::now();
+                incremental.Apply(event);
+                auto middle = Clock::now();
+                full.Rebuild();
+                auto finish = Clock::now();
+                incremental_times.push_back(
+                        std::chrono::duration<double, std::micro>(middle - start).count());
+                full_times.push_back(
+                        std::chrono::duration<double, std::micro>(finish - middle).count());
+                updated += incremental.LastUpdateLength();
+            });
+            tree.SubscribeToEvents(&observer);
+            std::vector<int> values(n);
+            for (int i = 0; i < n; ++i) {
+                values[i] = 2 * i;
+            }
+            tree.BuildFromSorted(values.begin(), values.end());
+            incremental_times.clear();
+            full_times.clear();
+            RunRandomQueries(&tree, 100, 2 * n, 3);
+
+            auto report = [](const char* name, std::vector<double> times) {
+                std::sort(times.begin(), times.end());
+                double total = 0;
+                for (double time : times) {
+                    total += time;
+                }
+                std::cout << "  " << name << ": mean " << std::fixed << std::setprecision(1)
+                          << total / static_cast<double>(times.size()) << " us, p50 "
+                          << times[times.size() / 2] << " us, p99 "
+                          << times[times.size() * 99 / 100] << " us, max " << times.back()
+                          << " us\n";
+            };
+            std::cout << "n = " << n << ", " << full_times.size() << " frames, "
+                      << static_cast<double>(updated) / static_cast<double>(full_times.size())
+                      << " places updated per frame\n";
+            report("full layout", full_times);
+            report("incremental layout", incremental_times);
+            size_t index = 0;
+            CheckPlaces(incremental, tree.Root(), 0, &index);
+        }
+    }
+
+    TEST(LayoutWorker, FramesComeInOrder) {
+        Tree tree;
+        EventPipeline<Event> pipeline;
+        // The same frames built on this thread
+        TreeMirror<int> mirror;
+        Layout layout;
+        std::vector<std::vector<int>> expected;
+        Observer<Event> observer([&](const Event& event) {
+            layout.Apply(event);
+            if (mirror.Apply(event)) {
+                ValuesFrame frame;
+                BuildValuesFrame(mirror, layout, &frame);
+                expected.push_back(frame.values);
+            }
+        });
+        tree.SubscribeToEvents(pipeline.GetObserver());
+        tree.SubscribeToEvents(&observer);
+        RunRandomQueries(&tree, 100, 50, 5);
+        std::atomic<size_t> ready_frames = 0;
+        LayoutWorker<int, ValuesFrame> worker(&pipeline, BuildValuesFrame, [&ready_frames]() {
+            ++ready_frames;
+        });
+        // Each frame is taken before the next one is asked for, so none is dropped
+        for (size_t frame = 0; frame < expected.size(); ++frame) {
+            worker.RequestFrame();
+            WaitForFrames(ready_frames, frame + 1);
+            std::shared_ptr<const ValuesFrame> taken = worker.TakeFrame();
+            ASSERT_NE(taken, nullptr);
+            ASSERT_EQ(taken->values, expected[frame]);
+        }
+        ASSERT_EQ(worker.TakeFrame(), nullptr);
+        ASSERT_EQ(worker.BuiltFrames(), expected.size());
+        ASSERT_EQ(worker.DroppedFrames(), 0);
+    }
+
+    TEST(LayoutWorker, SkippedFramesAreNotBuilt) {
+        Tree tree;
+        EventPipeline<Event> pipeline;
+        size_t steps = 0;
+        Observer<Event> step_observer([&steps](const Event& event) {
+            steps += event.type == TreeEventType::step;
+        });
+        tree.SubscribeToEvents(pipeline.GetObserver());
+        tree.SubscribeToEvents(&step_observer);
+        RunRandomQueries(&tree, 100, 50, 4);
+        std::atomic<size_t> ready_frames = 0;
+        LayoutWorker<int, ValuesFrame> worker(&pipeline, BuildValuesFrame, [&ready_frames]() {
+            ++ready_frames;
+        });
+        worker.RequestLastFrame();
+        WaitForFrames(ready_frames, 1);
+        std::shared_ptr<const ValuesFrame> frame = worker.TakeFrame();
+        ASSERT_NE(frame, nullptr);
+        ASSERT_EQ(frame->values, std::vector<int>(tree.begin(), tree.end()));
+        ASSERT_EQ(worker.BuiltFrames(), 1);
+        ASSERT_EQ(worker.DroppedFrames(), steps - 1);
+    }
+}// namespace DSVisualization
@@ -0,0 +1,252 @@
+#pragma once
+
+#include "red_black_tree.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace DSVisualization {
+    // Places of the nodes of a traced RedBlackTree for drawing it, put together from its
+    // events like TreeMirror: a node is drawn in the column of its in-order index and in the
+    // row of its depth. The places are kept between frames. A frame only lays out again the
+    // subtrees whose links changed, fixes the subtree sizes on their paths to the root and
+    // shifts the indices of the nodes after them in in-order, which stops as soon as a node
+    // keeps its index. So a rotation costs the size of the rotated subtrees, an insert or an
+    // erase at in-order index k costs O(n - k) index updates without any allocation.
+    template<typename T, typename Augmentation = NoAugmentation>
+    class TreeLayout {
+    public:
+        using Event = TreeEvent<RedBlackTreeNode<T, Augmentation>>;
+        using NodeId = const RedBlackTreeNode<T, Augmentation>*;
+
+        struct Place {
+            size_t index = 0;
+            size_t depth = 0;
+            size_t subtree_size = 1;
+            NodeId parent = nullptr;
+            NodeId left = nullptr;
+            NodeId right = nullptr;
+        };
+
+        // Returns true if the event completes a step, then the places are up to date
+        bool Apply(const Event& event) {
+            switch (event.type) {
+                case TreeEventType::tree_replaced:
+                    places_.clear();
+                    dirty_.clear();
+                    root_ = nullptr;
+                    rebuild_ = true;
+                    break;
+                case TreeEventType::node_created:
+                    places_.insert_or_assign(event.node, Place{});
+                    MarkDirty(event.node);
+                    break;
+                case TreeEventType::link_changed:
+                    Link(event.node, event.kid, event.other);
+                    break;
+                case TreeEventType::node_destroyed:
+                    places_.erase(event.node);
+                    dirty_.erase(event.node);
+                    break;
+                case TreeEventType::step:
+                    Update();
+                    return true;
+                default:
+                    break;
+            }
+            return false;
+        }
+
+        [[nodiscard]] NodeId Root() const {
+            return root_;
+        }
+
+        [[nodiscard]] const Place& GetPlace(NodeId id) const {
+            auto it = places_.find(id);
+            assert(it != places_.end());
+            return it->second;
+        }
+
+        // Number of the nodes in the tree, a node unlinked by an erase is not counted
+        [[nodiscard]] size_t Size() const {
+            return root_ ? GetPlace(root_).subtree_size : 0;
+        }
+
+        // Lays out the whole tree from scratch, O(n)
+        void Rebuild() {
+            dirty_.clear();
+            rebuild_ = false;
+            last_update_length_ = 0;
+            if (root_) {
+                ComputeSizes(root_);
+                LayOut(root_, 0, 0);
+            }
+        }
+
+        // Number of nodes whose place was computed again by the last step
+        [[nodiscard]] size_t LastUpdateLength() const {
+            return last_update_length_;
+        }
+
+    private:
+        // The node must be known, see Link for the events which may name unknown ones
+        Place& At(NodeId id) {
+            auto it = places_.find(id);
+            assert(it != places_.end());
+            return it->second;
+        }
+
+        void MarkDirty(NodeId id) {
+            if (!rebuild_) {
+                dirty_.insert(id);
+            }
+        }
+
+        // A link of a node which was never created is skipped, like TreeMirror does
+        void Link(NodeId parent, Kid side, NodeId kid) {
+            auto kid_it = kid ? places_.find(kid) : places_.end();
+            if (kid && kid_it == places_.end()) {
+                return;
+            }
+            if (!parent) {
+                root_ = kid;
+            } else if (auto it = places_.find(parent); it != places_.end()) {
+                (side == Kid::left ? it->second.left : it->second.right) = kid;
+                MarkDirty(parent);
+            } else {
+                return;
+            }
+            if (kid) {
+                kid_it->second.parent = parent;
+                MarkDirty(kid);
+            }
+        }
+
+        void Update() {
+            if (rebuild_) {
+                Rebuild();
+                return;
+            }
+            last_update_length_ = 0;
+            if (dirty_.empty()) {
+                return;
+            }
+            // The sizes along every path from a changed node to the root. The last walk
+            // through a node comes after the last walks through its kids, so it sees their
+            // final sizes.
+            for (NodeId id : dirty_) {
+                for (NodeId node = id; node; node = At(node).parent) {
+                    Place& place = At(node);
+                    place.subtree_size = 1 + SubtreeSize(place.left) + SubtreeSize(place.right);
+                }
+            }
+            // The highest changed nodes: the depths and the indices may only change in their
+            // subtrees, the nodes outside of them are only shifted in in-order
+            tops_.clear();
+            for (NodeId id : dirty_) {
+                bool is_top = true;
+                for (NodeId node = At(id).parent; node && is_top; node = At(node).parent) {
+                    is_top = !dirty_.contains(node);
+                }
+                if (is_top) {
+                    NodeId parent = At(id).parent;
+                    size_t first = Index(id) - SubtreeSize(At(id).left);
+                    tops_.emplace_back(first, id);
+                    LayOut(id, parent ? At(parent).depth + 1 : 0, first);
+                }
+            }
+            dirty_.clear();
+            std::sort(tops_.begin(), tops_.end());
+            for (size_t i = 0; i < tops_.size(); ++i) {
+                auto [first, top] = tops_[i];
+                NodeId stop = i + 1 < tops_.size() ? Leftmost(tops_[i + 1].second) : nullptr;
+                size_t index = first + At(top).subtree_size;
+                for (NodeId node = Next(Rightmost(top)); node != stop; node = Next(node)) {
+                    Place& place = At(node);
+                    if (place.index == index) {
+                        // The nodes up to the next changed subtree are shifted by the same
+                        break;
+                    }
+                    place.index = index++;
+                    ++last_update_length_;
+                }
+            }
+        }
+
+        size_t SubtreeSize(NodeId id) {
+            return id ? At(id).subtree_size : 0;
+        }
+
+        // In-order index from the sizes on the path to the root, O(depth)
+        size_t Index(NodeId id) {
+            size_t index = SubtreeSize(At(id).left);
+            for (NodeId node = id, parent = At(id).parent; parent;
+                 node = parent, parent = At(parent).parent) {
+                if (At(parent).right == node) {
+                    index += SubtreeSize(At(parent).left) + 1;
+                }
+            }
+            return index;
+        }
+
+        size_t ComputeSizes(NodeId id) {
+            Place& place = At(id);
+            place.subtree_size = 1 + (place.left ? ComputeSizes(place.left) : 0) +
+                                 (place.right ? ComputeSizes(place.right) : 0);
+            return place.subtree_size;
+        }
+
+        // Places the subtree with the first in-order index first, the sizes must be known
+        void LayOut(NodeId id, size_t depth, size_t first) {
+            Place& place = At(id);
+            place.depth = depth;
+            place.index = first + SubtreeSize(place.left);
+            ++last_update_length_;
+            if (place.left) {
+                LayOut(place.left, depth + 1, first);
+            }
+            if (place.right) {
+                LayOut(place.right, depth + 1, place.index + 1);
+            }
+        }
+
+        NodeId Leftmost(NodeId id) {
+            while (At(id).left) {
+                id = At(id).left;
+            }
+            return id;
+        }
+
+        NodeId Rightmost(NodeId id) {
+            while (At(id).right) {
+                id = At(id).right;
+            }
+            return id;
+        }
+
+        // The next node in in-order, nullptr after the last one
+        NodeId Next(NodeId id) {
+            if (At(id).right) {
+                return Leftmost(At(id).right);
+            }
+            NodeId parent = At(id).parent;
+            while (parent && At(parent).right == id) {
+                id = parent;
+                parent = At(parent).parent;
+            }
+            return parent;
+        }
+
+        std::unordered_map<NodeId, Place> places_;
+        std::unordered_set<NodeId> dirty_;
+        std::vector<std::pair<size_t, NodeId>> tops_;
+        NodeId root_ = nullptr;
+        bool rebuild_ = true;
+        size_t last_update_length_ = 0;
+    };
+}// namespace DSVisualization
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "red_black_tree.h"
+
+#include <cstddef>
+#include <unordered_map>
+
+namespace DSVisualization {
+    // Copy of a traced RedBlackTree put together from its events, so that a view can draw the
+    // tree while the model goes on changing it on another thread. The nodes are known by their
+    // addresses in the model, which are never dereferenced. Each event is applied in O(1).
+    template<typename T, typename Augmentation = NoAugmentation>
+    class TreeMirror {
+    public:
+        using Event = TreeEvent<RedBlackTreeNode<T, Augmentation>>;
+        using NodeId = const RedBlackTreeNode<T, Augmentation>*;
+
+        struct Node {
+            T value;
+            Color color;
+            NodeId left = nullptr;
+            NodeId right = nullptr;
+        };
+
+        // Returns true if the event completes a step, then the mirror is the frame to draw
+        bool Apply(const Event& event) {
+            switch (event.type) {
+                case TreeEventType::tree_replaced:
+                    nodes_.clear();
+                    break;
+                case TreeEventType::node_created:
+                    nodes_.insert_or_assign(event.node,
+                                           Node{*event.value, event.color, nullptr, nullptr});
+                    break;
+                case TreeEventType::recolor:
+                    if (auto it = nodes_.find(event.node); it != nodes_.end()) {
+                        it->second.color = event.color;
+                    }
+                    break;
+                case TreeEventType::link_changed:
+                    if (auto it = nodes_.find(event.node); it != nodes_.end()) {
+                        (event.kid == Kid::left ? it->second.left : it->second.right) =
+                                event.other;
+                    }
+                    break;
+                case TreeEventType::node_destroyed:
+                    nodes_.erase(event.node);
+                    break;
+                default:
+                    break;
+            }
+            return tree_info_builder_.Apply(event);
+        }
+
+        [[nodiscard]] NodeId Root() const {
+            return tree_info_builder_.GetTreeInfo().root;
+        }
+
+        // nullptr if the node is unknown
+        [[nodiscard]] const Node* Find(NodeId id) const {
+            auto it = nodes_.find(id);
+            return it == nodes_.end() ? nullptr : &it->second;
+        }
+
+        [[nodiscard]] Status GetStatus(NodeId id) const {
+            const auto& node_to_status = tree_info_builder_.GetTreeInfo().node_to_status;
+            auto it = node_to_status.find(id);
+            return it == node_to_status.end() ? Status::initial : it->second;
+        }
+
+        [[nodiscard]] size_t Size() const {
+            return tree_info_builder_.GetTreeInfo().tree_size;
+        }
+
+    private:
+        std::unordered_map<NodeId, Node> nodes_;
+        TreeInfoBuilder<T, Augmentation> tree_info_builder_;
+    };
+}// namespace DSVisualization
@@ -4,12 +4,23 @@
 #include "queries.h"
 #include "utility.h"
 
+#include <algorithm>
+#include <cassert>
+#include <cmath>
 #include <memory>
+#include <optional>
 #include <sstream>
+#include <string>
+#include <variant>
+#include <vector>
 
+#include <QImage>
 #include <QLayout>
+#include <QPainter>
 #include <QPushButton>
+#include <QScrollBar>
 #include <QString>
+#include <QWheelEvent>
 #include <QtWidgets>
 
 namespace DSVisualization {
@@ -41,16 +52,7 @@ namespace DSVisualization {
     }// namespace
 
     View::View()
-        : main_window_(), observer_model_view_(
-                                  [this](const RedBlackTree<int>::Data& x) {
-                                      OnNotifyFromModel(x);
-                                  },
-                                  [this](const RedBlackTree<int>::Data& x) {
-                                      OnNotifyFromModel(x);
-                                  },
-                                  [this](const RedBlackTree<int>::Data& x) {
-                                      OnNotifyFromModel(x);
-                                  }),
+        : main_window_(),
           observable_view_controller_([this]() {
               return this->query_;
           }) {
@@ -62,11 +64,23 @@ namespace DSVisualization {
                          &View::OnEraseButtonPushed);
         QObject::connect(main_window_.find_button_, &QPushButton::clicked, this,
                          &View::OnFindButtonPushed);
-    }
-
-    [[nodiscard]] Observer<RedBlackTree<int>::Data>* View::GetObserver() {
-        PRINT_WHERE_AM_I();
-        return &observer_model_view_;
+        QObject::connect(main_window_.step_button_, &QPushButton::clicked, this,
+                         &View::OnStepButtonPushed);
+        QObject::connect(main_window_.pause_button_, &QPushButton::toggled, this,
+                         &View::OnPauseToggled);
+        QObject::connect(main_window_.next_frame_button_, &QPushButton::clicked, this,
+                         &View::PlayFrame);
+        QObject::connect(main_window_.skip_button_, &QPushButton::clicked, this,
+                         &View::OnSkipButtonPushed);
+        QObject::connect(main_window_.speed_slider_, &QSlider::valueChanged, this,
+                         &View::OnSpeedChanged);
+        // Panning and zooming draw the newly visible part of the same frame
+        main_window_.tree_view_->setDragMode(QGraphicsView::ScrollHandDrag);
+        main_window_.tree_view_->viewport()->installEventFilter(this);
+        QObject::connect(main_window_.tree_view_->horizontalScrollBar(), &QScrollBar::valueChanged,
+                         this, &View::ScheduleRedraw);
+        QObject::connect(main_window_.tree_view_->verticalScrollBar(), &QScrollBar::valueChanged,
+                         this, &View::ScheduleRedraw);
     }
 
     template<typename T>
@@ -75,23 +89,129 @@ namespace DSVisualization {
         return static_cast<float>(value);
     }
 
-    static void Delay(int milliseconds) {
-        QEventLoop loop;
-        QTimer t;
-        QTimer::connect(&t, &QTimer::timeout, &loop, &QEventLoop::quit);
-        t.start(milliseconds);
-        loop.exec();
+    // One pass over the nodes, each node goes to the column of its in-order index. Runs on the
+    // thread of the layout worker.
+    static void FillDrawableTree(const TreeMirror<int>& tree, const TreeLayout<int>& layout,
+                                 float column_width, float row_height,
+                                 std::vector<TreeMirror<int>::NodeId>* stack,
+                                 DrawableTree* drawable_tree) {
+        drawable_tree->Resize(layout.Size());
+        drawable_tree->root = DrawableTree::no_kid;
+        drawable_tree->max_y = 0;
+        stack->clear();
+        if (tree.Root()) {
+            stack->push_back(tree.Root());
+            drawable_tree->root = layout.GetPlace(tree.Root()).index;
+        }
+        while (!stack->empty()) {
+            TreeMirror<int>::NodeId id = stack->back();
+            stack->pop_back();
+            const TreeMirror<int>::Node* node = tree.Find(id);
+            const TreeLayout<int>::Place& place = layout.GetPlace(id);
+            size_t i = place.index;
+            drawable_tree->ids[i] = id;
+            drawable_tree->x[i] = IntegralToFloat(place.index) * column_width;
+            drawable_tree->y[i] = IntegralToFloat(place.depth) * row_height;
+            drawable_tree->max_y = std::max(drawable_tree->max_y, drawable_tree->y[i]);
+            drawable_tree->keys[i] = node->value;
+            drawable_tree->subtree_sizes[i] = place.subtree_size;
+            drawable_tree->inside_colors[i] = (node->color == Color::red ? Qt::red : Qt::black);
+            drawable_tree->outside_colors[i] = FromStatusToQTColor(tree.GetStatus(id));
+            drawable_tree->left[i] = DrawableTree::no_kid;
+            drawable_tree->right[i] = DrawableTree::no_kid;
+            if (node->left) {
+                drawable_tree->left[i] = layout.GetPlace(node->left).index;
+                stack->push_back(node->left);
+            }
+            if (node->right) {
+                drawable_tree->right[i] = layout.GetPlace(node->right).index;
+                stack->push_back(node->right);
+            }
+        }
     }
 
-    void View::OnNotifyFromModel(const RedBlackTree<int>::Data& value) {
+    void View::SubscribeToEvents(EventPipeline<Event>* pipeline) {
         PRINT_WHERE_AM_I();
-        float counter = 0;
-        tree_width_ = IntegralToFloat(value.tree_size) *
+        layout_worker_ = std::make_unique<LayoutWorker<int, DrawableTree>>(
+                pipeline,
+                [stack = std::vector<TreeMirror<int>::NodeId>()](
+                        const TreeMirror<int>& tree, const TreeLayout<int>& layout,
+                        DrawableTree* drawable_tree) mutable {
+                    FillDrawableTree(tree, layout,
+                                     horizontal_space_between_nodes + default_node_diameter,
+                                     default_node_diameter + vertical_space_between_nodes, &stack,
+                                     drawable_tree);
+                },
+                [this]() {
+                    // Dropped by Qt if the view is gone by then
+                    QMetaObject::invokeMethod(this, &View::OnFrameReady, Qt::QueuedConnection);
+                });
+        QObject::connect(&frame_timer_, &QTimer::timeout, this, &View::PlayFrame);
+        frame_timer_.start(draw_delay_in_ms);
+    }
+
+    // Asks the layout worker for the next frame, it is drawn when the worker is done with it
+    void View::PlayFrame() {
+        if (layout_worker_) {
+            layout_worker_->RequestFrame();
+        }
+    }
+
+    void View::OnPauseToggled(bool paused) {
+        PRINT_WHERE_AM_I();
+        main_window_.pause_button_->setText(paused ? "Play" : "Pause");
+        if (paused) {
+            frame_timer_.stop();
+        } else {
+            frame_timer_.start();
+        }
+    }
+
+    void View::OnSkipButtonPushed() {
+        PRINT_WHERE_AM_I();
+        if (layout_worker_) {
+            layout_worker_->RequestLastFrame();
+        }
+    }
+
+    void View::OnSpeedChanged(int speed_power) {
+        PRINT_WHERE_AM_I();
+        frame_timer_.setInterval(speed_power >= 0 ? draw_delay_in_ms >> speed_power
+                                                  : draw_delay_in_ms << -speed_power);
+    }
+
+    // Only the newest frame is drawn, the older ones which came meanwhile are dropped
+    void View::OnFrameReady() {
+        PRINT_WHERE_AM_I();
+        std::shared_ptr<const DrawableTree> frame = layout_worker_->TakeFrame();
+        if (frame) {
+            DrawFrame(std::move(frame));
+        }
+    }
+
+    void View::LayOutFrame(const TreeMirror<int>& tree, const TreeLayout<int>& layout,
+                           DrawableTree* drawable_tree) {
+        FillDrawableTree(tree, layout, horizontal_space_between_nodes + default_node_diameter,
+                         default_node_diameter + vertical_space_between_nodes, &layout_stack_,
+                         drawable_tree);
+    }
+
+    void View::DrawFrame(std::shared_ptr<const DrawableTree> frame) {
+        drawable_tree_ = std::move(frame);
+        tree_width_ = IntegralToFloat(drawable_tree_->Size()) *
                       (horizontal_space_between_nodes + default_node_diameter);
-        std::unique_ptr<DrawableTree> result = std::make_unique<DrawableTree>(
-                DrawableTree{GetDrawableNode(value, value.root, 0, counter)});
-        this->DrawTree(result);
-        Delay(draw_delay_in_ms);
+        DrawTree();
+    }
+
+    void View::PaintTree(QImage* image) const {
+        QGraphicsView* tree_view = main_window_.tree_view_;
+        QSize size = tree_view->viewport()->size();
+        if (image->size() != size) {
+            *image = QImage(size, QImage::Format_ARGB32_Premultiplied);
+        }
+        image->fill(Qt::white);
+        QPainter painter(image);
+        tree_view->render(&painter);
     }
 
     void View::SubscribeToQuery(Observer<TreeQuery>* observer_view_controller) {
@@ -99,6 +219,28 @@ namespace DSVisualization {
         observable_view_controller_.Subscribe(observer_view_controller);
     }
 
+    void View::DisableQueries() {
+        PRINT_WHERE_AM_I();
+        main_window_.DisableButtons();
+    }
+
+    bool View::eventFilter(QObject* watched, QEvent* event) {
+        QGraphicsView* tree_view = main_window_.tree_view_;
+        if (watched == tree_view->viewport() && event->type() == QEvent::Resize) {
+            ScheduleRedraw();
+        }
+        if (watched != tree_view->viewport() || event->type() != QEvent::Wheel) {
+            return QGraphicsView::eventFilter(watched, event);
+        }
+        auto* wheel_event = static_cast<QWheelEvent*>(event);
+        // One notch of the wheel is 120
+        qreal factor = std::pow(zoom_step, wheel_event->angleDelta().y() / 120.0);
+        tree_view->setTransformationAnchor(QGraphicsView::AnchorUnderMouse);
+        tree_view->scale(factor, factor);
+        ScheduleRedraw();
+        return true;
+    }
+
     void View::OnInsertButtonPushed() {
         PRINT_WHERE_AM_I();
         std::string str = GetTextAndClear(main_window_.insert_line_edit_);
@@ -117,6 +259,12 @@ namespace DSVisualization {
         HandlePushButton(TreeQueryType::find, str);
     }
 
+    void View::OnStepButtonPushed() {
+        PRINT_WHERE_AM_I();
+        std::string str = GetTextAndClear(main_window_.step_line_edit_);
+        HandlePushButton(TreeQueryType::go_to_step, str);
+    }
+
     namespace {
         const int MIN_VALUE = -(1 << 15);
         const int MAX_VALUE = (1 << 15) - 1;
@@ -157,115 +305,308 @@ namespace DSVisualization {
         }
     }// namespace
 
+    // The text may hold several values separated by spaces or commas, they are all queued at
+    // once if every one of them is valid. The buttons stay enabled, the controller queues the
+    // queries sent while the model is busy.
     void View::HandlePushButton(TreeQueryType query_type, const std::string& text) {
         PRINT_WHERE_AM_I();
-        main_window_.DisableButtons();
-        std::variant<int, std::string> value = string_to_int(text);
-        if (value.index() == 0) {
-            query_ = {query_type, std::get<int>(value)};
-            observable_view_controller_.Notify();
+        std::string separated = text;
+        std::replace(separated.begin(), separated.end(), ',', ' ');
+        std::istringstream words(separated);
+        std::vector<int> values;
+        std::string word;
+        std::optional<std::string> error;
+        while (words >> word && !error) {
+            std::variant<int, std::string> value = string_to_int(word);
+            if (value.index() == 0) {
+                values.push_back(std::get<int>(value));
+            } else {
+                error = std::get<std::string>(value);
+            }
+        }
+        if (values.empty() && !error) {
+            error = "Empty query";
+        }
+        if (error) {
+            QMessageBox::critical(nullptr, "Error", error->c_str());
         } else {
-            QMessageBox messageBox;
-            QMessageBox::critical(nullptr, "Error", std::get<std::string>(value).c_str());
+            for (int value : values) {
+                query_ = {query_type, value};
+                observable_view_controller_.Notify();
+            }
         }
-        main_window_.EnableButtons();
-    }
-
-    std::unique_ptr<DrawableNode> View::GetDrawableNode(const TreeInfo<int>& tree_info,
-                                                        const RedBlackTree<int>::Node* node,
-                                                        float depth, float& counter) {
-        if (!node) {
-            return nullptr;
-        }
-
-        std::unique_ptr<DrawableNode> result = std::make_unique<DrawableNode>(DrawableNode{
-                0, 0, 0, Qt::black, FromStatusToQTColor(Status::initial), nullptr, nullptr});
-        result->left = GetDrawableNode(tree_info, node->left.get(), depth + 1, counter);
-        result->x = counter * (horizontal_space_between_nodes + default_node_diameter);
-        result->y = depth * (default_node_diameter + vertical_space_between_nodes);
-        assert(result);
-        assert(node);
-        result->key = node->value;
-        result->inside_color = (node->color == Color::red ? Qt::red : Qt::black);
-        {
-            auto it = tree_info.node_to_status.find(node);
-            auto status =
-                    (it == tree_info.node_to_status.end() ? Status::initial
-                                                          : tree_info.node_to_status.at(node));
-            result->outside_color = FromStatusToQTColor(status);
-        }
-        counter++;
-        result->right = GetDrawableNode(tree_info, node->right.get(), depth + 1, counter);
-        return result;
     }
 
-    void View::DrawTree(const std::unique_ptr<DrawableTree>& tree) {
+    void View::DrawTree() {
         PRINT_WHERE_AM_I();
-        main_window_.tree_view_->scene()->clear();
         current_node_diameter_ = default_node_diameter;
+        x_scale_ = 1;
         main_window_.current_width_ = IntegralToFloat(size().width());
-        if (tree_width_ + default_node_diameter + MainWindow::margin >=
-            main_window_.current_width_) {
-            current_node_diameter_ = (default_node_diameter * main_window_.current_width_) /
-                                     (tree_width_ + default_node_diameter + MainWindow::margin);
+        float full_width = tree_width_ + default_node_diameter + MainWindow::margin;
+        if (full_width >= main_window_.current_width_) {
+            current_node_diameter_ =
+                    (default_node_diameter * main_window_.current_width_) / full_width;
+            x_scale_ = main_window_.current_width_ / full_width;
         }
-        RecursiveDraw(tree->root);
+        // Only the visible nodes have items, so the scene can't find its size from them
+        main_window_.tree_view_->scene()->setSceneRect(
+                0, 0, tree_width_ * x_scale_ + current_node_diameter_,
+                drawable_tree_->max_y + 2 * current_node_diameter_);
+        DrawVisible();
         main_window_.tree_view_->show();
     }
 
-    void View::DrawNode(const std::unique_ptr<DrawableNode>& node) {
+    // Draws the nodes in the viewport, from the root down. A subtree out of the viewport is
+    // skipped as a whole and a subtree too small on the screen is drawn as one glyph, so a
+    // frame costs the number of visible items, not the size of the tree. The scene keeps its
+    // items in its spatial index, which paints only the items in the viewport.
+    void View::DrawVisible() {
         PRINT_WHERE_AM_I();
-        QPen pen;
-        QBrush brush;
-        pen.setWidth(5);
-        brush.setColor(node->inside_color);
-        brush.setStyle(Qt::SolidPattern);
-        pen.setColor(node->outside_color);
-        main_window_.tree_view_->scene()->addEllipse(node->x, node->y, current_node_diameter_,
-                                                     current_node_diameter_, pen, brush);
-        auto* text = new QGraphicsTextItem(std::to_string(node->key).c_str());
-        auto rect = text->boundingRect();
-        text->setPos(node->x - rect.width() / 2 + current_node_diameter_ / 2,
-                     node->y - rect.height() / 2 + current_node_diameter_ / 2);
-        text->setDefaultTextColor(Qt::white);
-        main_window_.tree_view_->scene()->addItem(text);
+        ++frame_;
+        QGraphicsView* tree_view = main_window_.tree_view_;
+        QRectF visible = tree_view->mapToScene(tree_view->viewport()->rect()).boundingRect();
+        qreal zoom = tree_view->transform().m11();
+        qreal column_width =
+                (horizontal_space_between_nodes + default_node_diameter) * x_scale_ * zoom;
+        bool collapse = current_node_diameter_ * zoom < min_node_size_in_pixels;
+        labels_visible_ = current_node_diameter_ * zoom >= min_label_size_in_pixels;
+        const DrawableTree& tree = *drawable_tree_;
+        index_stack_.clear();
+        if (tree.root != DrawableTree::no_kid) {
+            index_stack_.push_back(tree.root);
+        }
+        while (!index_stack_.empty()) {
+            size_t i = index_stack_.back();
+            index_stack_.pop_back();
+            size_t first = tree.FirstColumn(i);
+            size_t last = tree.LastColumn(i);
+            // The kids are deeper, so a subtree below the viewport is out of it as well
+            if (X(last) + current_node_diameter_ < visible.left() || X(first) > visible.right() ||
+                tree.y[i] > visible.bottom()) {
+                continue;
+            }
+            if (collapse && first != last &&
+                IntegralToFloat(last - first + 1) * column_width < min_glyph_width_in_pixels) {
+                DrawGlyph(i);
+                continue;
+            }
+            DrawNode(i);
+            if (tree.left[i] != DrawableTree::no_kid) {
+                DrawEdgeBetweenNodes(i, true);
+                index_stack_.push_back(tree.left[i]);
+            }
+            if (tree.right[i] != DrawableTree::no_kid) {
+                DrawEdgeBetweenNodes(i, false);
+                index_stack_.push_back(tree.right[i]);
+            }
+        }
+        RemoveStaleItems();
     }
 
-    void View::DrawEdgeBetweenNodes(const std::unique_ptr<DrawableNode>& parent,
-                                    bool is_child_left) {
-        PRINT_WHERE_AM_I();
-        std::cerr << "radius = " << current_node_diameter_ << std::endl;
-        float x1 = parent->x;
-        float y1 = parent->y;
-        float x2 = is_child_left ? parent->left->x : parent->right->x;
-        float y2 = is_child_left ? parent->left->y : parent->right->y;
-        auto* horizontal_line = new QGraphicsLineItem(
-                x1 + (is_child_left ? 0 : current_node_diameter_), y1 + current_node_diameter_ / 2,
-                x2 + current_node_diameter_ / 2, y1 + current_node_diameter_ / 2);
-        auto* vertical_line = new QGraphicsLineItem(x2 + current_node_diameter_ / 2,
-                                                    y1 + current_node_diameter_ / 2,
-                                                    x2 + current_node_diameter_ / 2, y2);
-        main_window_.tree_view_->scene()->addItem(horizontal_line);
-        main_window_.tree_view_->scene()->addItem(vertical_line);
+    // Many scroll bar moves and wheel turns between two paints make one redraw
+    void View::ScheduleRedraw() {
+        if (redraw_pending_) {
+            return;
+        }
+        redraw_pending_ = true;
+        QTimer::singleShot(0, this, [this]() {
+            redraw_pending_ = false;
+            DrawVisible();
+        });
     }
 
-    void View::RecursiveDraw(const std::unique_ptr<DrawableNode>& node) {
-        if (!node) {
+    float View::X(size_t node) const {
+        return drawable_tree_->x[node] * x_scale_;
+    }
+
+    // The black nodes on the leftmost path, every path down has the same number of them
+    size_t View::BlackHeight(size_t node) const {
+        size_t black_height = 0;
+        for (; node != DrawableTree::no_kid; node = drawable_tree_->left[node]) {
+            if (drawable_tree_->inside_colors[node] == Qt::black) {
+                ++black_height;
+            }
+        }
+        return black_height;
+    }
+
+    void View::DrawNode(size_t node) {
+        PRINT_WHERE_AM_I();
+        QGraphicsScene* scene = main_window_.tree_view_->scene();
+        const DrawableTree& tree = *drawable_tree_;
+        float x = X(node);
+        float y = tree.y[node];
+        int key = tree.keys[node];
+        size_t subtree_size = tree.subtree_sizes[node];
+        NodeItems& items = scene_items_[tree.ids[node]];
+        items.frame = frame_;
+        if (items.glyph) {
+            delete items.glyph;
+            delete items.glyph_text;
+            items.glyph = nullptr;
+            items.glyph_text = nullptr;
+        }
+        if (!items.circle) {
+            QPen pen;
+            pen.setWidth(5);
+            items.circle = scene->addEllipse(0, 0, 0, 0, pen, QBrush(Qt::SolidPattern));
+        }
+        // The setters of Qt do nothing if the value is the same
+        items.circle->setRect(x, y, current_node_diameter_, current_node_diameter_);
+        if (items.circle->brush().color() != tree.inside_colors[node]) {
+            items.circle->setBrush(QBrush(tree.inside_colors[node], Qt::SolidPattern));
+        }
+        if (items.circle->pen().color() != tree.outside_colors[node]) {
+            QPen pen = items.circle->pen();
+            pen.setColor(tree.outside_colors[node]);
+            items.circle->setPen(pen);
+        }
+        if (!labels_visible_) {
+            // The texts are made only once they can be read
+            if (items.key_text) {
+                items.key_text->setVisible(false);
+                items.size_text->setVisible(false);
+            }
             return;
         }
-        if (tree_width_ + default_node_diameter + MainWindow::margin >=
-            main_window_.current_width_) {
-            node->x = node->x / (tree_width_ + default_node_diameter + MainWindow::margin) *
-                      main_window_.current_width_;
+        if (!items.key_text) {
+            items.key_text = new QGraphicsTextItem(std::to_string(key).c_str());
+            items.key_text->setDefaultTextColor(Qt::white);
+            scene->addItem(items.key_text);
+            items.size_text = new QGraphicsTextItem(std::to_string(subtree_size).c_str());
+            QFont size_font = items.size_text->font();
+            size_font.setPointSizeF(size_font.pointSizeF() * size_text_scale);
+            items.size_text->setFont(size_font);
+            items.size_text->setDefaultTextColor(Qt::darkGray);
+            scene->addItem(items.size_text);
+            items.key = key;
+            items.subtree_size = subtree_size;
+        }
+        items.key_text->setVisible(true);
+        items.size_text->setVisible(true);
+        if (items.key != key) {
+            items.key = key;
+            items.key_text->setPlainText(std::to_string(key).c_str());
+        }
+        auto rect = items.key_text->boundingRect();
+        items.key_text->setPos(x - rect.width() / 2 + current_node_diameter_ / 2,
+                               y - rect.height() / 2 + current_node_diameter_ / 2);
+        if (items.subtree_size != subtree_size) {
+            items.subtree_size = subtree_size;
+            items.size_text->setPlainText(std::to_string(subtree_size).c_str());
+        }
+        auto size_rect = items.size_text->boundingRect();
+        items.size_text->setPos(x + current_node_diameter_ / 2 - size_rect.width() / 2,
+                                y + current_node_diameter_ - size_rect.height() / 2);
+    }
+
+    // A triangle over the columns of the subtree, as high as its black height, with the number
+    // of its nodes and its black height when there is room for them
+    void View::DrawGlyph(size_t node) {
+        PRINT_WHERE_AM_I();
+        QGraphicsScene* scene = main_window_.tree_view_->scene();
+        const DrawableTree& tree = *drawable_tree_;
+        size_t first = tree.FirstColumn(node);
+        size_t last = tree.LastColumn(node);
+        size_t subtree_size = tree.subtree_sizes[node];
+        size_t black_height = BlackHeight(node);
+        float top = tree.y[node];
+        float bottom = top + IntegralToFloat(black_height) *
+                                     (default_node_diameter + vertical_space_between_nodes);
+        QPolygonF triangle;
+        triangle << QPointF(X(node) + current_node_diameter_ / 2, top)
+                 << QPointF(X(last) + current_node_diameter_, bottom) << QPointF(X(first), bottom);
+        NodeItems& items = scene_items_[tree.ids[node]];
+        items.frame = frame_;
+        if (items.circle) {
+            delete items.circle;
+            delete items.key_text;
+            delete items.size_text;
+            items.circle = nullptr;
+            items.key_text = nullptr;
+            items.size_text = nullptr;
+        }
+        if (!items.glyph) {
+            items.glyph = scene->addPolygon(triangle, QPen(Qt::NoPen),
+                                            QBrush(Qt::darkGray, Qt::SolidPattern));
+            items.glyph_text = scene->addSimpleText("");
+            // The same size at any zoom
+            items.glyph_text->setFlag(QGraphicsItem::ItemIgnoresTransformations);
+            items.subtree_size = 0;
+        } else {
+            items.glyph->setPolygon(triangle);
+        }
+        if (items.subtree_size != subtree_size || items.black_height != black_height) {
+            items.subtree_size = subtree_size;
+            items.black_height = black_height;
+            std::string text = std::to_string(subtree_size) + " / " + std::to_string(black_height);
+            items.glyph_text->setText(text.c_str());
+            items.glyph->setToolTip(QString::fromStdString(std::to_string(subtree_size) +
+                                                           " nodes, black height " +
+                                                           std::to_string(black_height)));
         }
-        RecursiveDraw(node->left);
-        if (node->left) {
-            DrawEdgeBetweenNodes(node, true);
+        qreal zoom = main_window_.tree_view_->transform().m11();
+        qreal width_in_pixels = (X(last) + current_node_diameter_ - X(first)) * zoom;
+        items.glyph_text->setVisible(width_in_pixels >= min_glyph_label_width_in_pixels);
+        items.glyph_text->setPos(X(node), (top + bottom) / 2);
+    }
+
+    void View::DrawEdgeBetweenNodes(size_t parent, bool is_child_left) {
+        PRINT_WHERE_AM_I();
+        size_t child = is_child_left ? drawable_tree_->left[parent] : drawable_tree_->right[parent];
+        float x1 = X(parent);
+        float y1 = drawable_tree_->y[parent];
+        float x2 = X(child);
+        float y2 = drawable_tree_->y[child];
+        QLineF horizontal_line(x1 + (is_child_left ? 0 : current_node_diameter_),
+                               y1 + current_node_diameter_ / 2, x2 + current_node_diameter_ / 2,
+                               y1 + current_node_diameter_ / 2);
+        QLineF vertical_line(x2 + current_node_diameter_ / 2, y1 + current_node_diameter_ / 2,
+                             x2 + current_node_diameter_ / 2, y2);
+        NodeItems& items = scene_items_[drawable_tree_->ids[child]];
+        items.edge_frame = frame_;
+        if (!items.horizontal_edge) {
+            items.horizontal_edge = main_window_.tree_view_->scene()->addLine(horizontal_line);
+            items.vertical_edge = main_window_.tree_view_->scene()->addLine(vertical_line);
+            // Under the nodes whatever the order they were added in
+            items.horizontal_edge->setZValue(-1);
+            items.vertical_edge->setZValue(-1);
+        } else {
+            items.horizontal_edge->setLine(horizontal_line);
+            items.vertical_edge->setLine(vertical_line);
         }
-        DrawNode(node);
-        RecursiveDraw(node->right);
-        if (node->right) {
-            DrawEdgeBetweenNodes(node, false);
+    }
+
+    // Deleting an item takes it off the scene. The edge from the parent stays while the parent
+    // is drawn, even if the node itself has gone out of the viewport.
+    void View::RemoveStaleItems() {
+        for (auto it = scene_items_.begin(); it != scene_items_.end();) {
+            NodeItems& items = it->second;
+            bool node_drawn = items.frame == frame_;
+            bool edge_drawn = items.edge_frame == frame_;
+            if (!node_drawn) {
+                delete items.circle;
+                delete items.key_text;
+                delete items.size_text;
+                delete items.glyph;
+                delete items.glyph_text;
+                items.circle = nullptr;
+                items.key_text = nullptr;
+                items.size_text = nullptr;
+                items.glyph = nullptr;
+                items.glyph_text = nullptr;
+            }
+            if (!edge_drawn) {
+                delete items.horizontal_edge;
+                delete items.vertical_edge;
+                items.horizontal_edge = nullptr;
+                items.vertical_edge = nullptr;
+            }
+            if (!node_drawn && !edge_drawn) {
+                it = scene_items_.erase(it);
+                continue;
+            }
+            ++it;
         }
     }
 }// namespace DSVisualization
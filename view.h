@@ -1,72 +1,182 @@
 #pragma once
 
+#include "event_pipeline.h"
+#include "layout_worker.h"
 #include "main_window.h"
 #include "queries.h"
 #include "red_black_tree.h"
+#include "tree_layout.h"
+#include "tree_mirror.h"
 
 #include <functional>
 #include <iostream>
 #include <memory>
 #include <optional>
 #include <set>
+#include <unordered_map>
+#include <vector>
 
 #include <QGraphicsScene>
 #include <QGraphicsView>
+#include <QTimer>
 #include <QtWidgets>
 
 namespace DSVisualization {
-    struct DrawableNode {
-        float x;
-        float y;
-        int key;
-        QColor outside_color;
-        QColor inside_color;
-        std::unique_ptr<DrawableNode> left;
-        std::unique_ptr<DrawableNode> right;
+    // The frame to draw as parallel arrays with the nodes in in-order, so the i-th node is in
+    // the i-th column. The layout worker refills the few it keeps, which allocates nothing
+    // once the arrays have grown to the size of the tree. A subtree takes the columns from the
+    // one of its leftmost node to the one of its rightmost node, so the subtrees out of sight
+    // are skipped without looking at their nodes.
+    struct DrawableTree {
+        static constexpr size_t no_kid = static_cast<size_t>(-1);
+
+        void Resize(size_t size) {
+            ids.resize(size);
+            x.resize(size);
+            y.resize(size);
+            keys.resize(size);
+            subtree_sizes.resize(size);
+            outside_colors.resize(size);
+            inside_colors.resize(size);
+            left.resize(size);
+            right.resize(size);
+        }
+
+        [[nodiscard]] size_t Size() const {
+            return ids.size();
+        }
+
+        // The columns of the leftmost and the rightmost nodes of the subtree
+        [[nodiscard]] size_t FirstColumn(size_t node) const {
+            return node - (left[node] == no_kid ? 0 : subtree_sizes[left[node]]);
+        }
+
+        [[nodiscard]] size_t LastColumn(size_t node) const {
+            return node + (right[node] == no_kid ? 0 : subtree_sizes[right[node]]);
+        }
+
+        std::vector<TreeMirror<int>::NodeId> ids;
+        std::vector<float> x;
+        std::vector<float> y;
+        std::vector<int> keys;
+        std::vector<size_t> subtree_sizes;
+        std::vector<QColor> outside_colors;
+        std::vector<QColor> inside_colors;
+        // Indices of the kids or no_kid
+        std::vector<size_t> left;
+        std::vector<size_t> right;
+        size_t root = no_kid;
+        // The y of the deepest node
+        float max_y = 0;
     };
 
-    struct DrawableTree {
-        std::unique_ptr<DrawableNode> root;
+    // The scene items of one node, kept from frame to frame while the node lives
+    struct NodeItems {
+        QGraphicsEllipseItem* circle = nullptr;
+        QGraphicsTextItem* key_text = nullptr;
+        QGraphicsTextItem* size_text = nullptr;
+        // Drawn instead of the circle when the whole subtree is too small to be told apart
+        QGraphicsPolygonItem* glyph = nullptr;
+        QGraphicsSimpleTextItem* glyph_text = nullptr;
+        // The edge from the parent, nullptr for the root
+        QGraphicsLineItem* horizontal_edge = nullptr;
+        QGraphicsLineItem* vertical_edge = nullptr;
+        // What the texts show
+        int key = 0;
+        size_t subtree_size = 0;
+        size_t black_height = 0;
+        // The last frames the node and its edge were drawn in
+        size_t frame = 0;
+        size_t edge_frame = 0;
     };
 
     class View : public QGraphicsView {
     public:
+        using Event = RedBlackTree<int>::Event;
+
         View();
         View(const View&) = delete;
         View& operator=(const View&) = delete;
         View(View&&) = delete;
         View& operator=(View&&) = delete;
 
-        [[nodiscard]] Observer<RedBlackTree<int>::Data>* GetObserver();
+        // Starts playing the frames the model publishes to the pipeline, one frame every
+        // draw_delay_in_ms at normal speed. The playback can be paused, stepped frame by frame
+        // and skipped to the last frame, queries can be sent at any time meanwhile. The frames
+        // are laid out on a thread of their own, this thread only draws them.
+        void SubscribeToEvents(EventPipeline<Event>* pipeline);
         void SubscribeToQuery(Observer<TreeQuery>* observer_view_controller);
+        // For playing a recorded run, the playback controls stay
+        void DisableQueries();
+
+        // For drawing frames laid out on this thread instead of by the layout worker, see
+        // render_benchmark.cpp. A frame is filled the way the worker fills it, drawn as the
+        // worker's frames are, and the tree view with it can be painted into an image.
+        void LayOutFrame(const TreeMirror<int>& tree, const TreeLayout<int>& layout,
+                         DrawableTree* drawable_tree);
+        void DrawFrame(std::shared_ptr<const DrawableTree> frame);
+        void PaintTree(QImage* image) const;
+
+    protected:
+        // Zooms the tree with the mouse wheel, draws the newly visible part on a resize
+        bool eventFilter(QObject* watched, QEvent* event) override;
 
     private:
-        void OnNotifyFromModel(const RedBlackTree<int>::Data& value);
+        void PlayFrame();
+        void OnPauseToggled(bool paused);
+        void OnSkipButtonPushed();
+        void OnSpeedChanged(int speed_power);
+        void OnFrameReady();
 
         void OnInsertButtonPushed();
         void OnEraseButtonPushed();
         void OnFindButtonPushed();
+        void OnStepButtonPushed();
         void HandlePushButton(DSVisualization::TreeQueryType query_type, const std::string& text);
 
-        std::unique_ptr<DrawableNode> GetDrawableNode(const TreeInfo<int>& tree_info,
-                                                      const RedBlackTree<int>::Node* node,
-                                                      float depth, float& counter);
-
-        void DrawTree(const std::unique_ptr<DrawableTree>& tree);
-        void DrawNode(const std::unique_ptr<DrawableNode>& node);
-        void DrawEdgeBetweenNodes(const std::unique_ptr<DrawableNode>& parent, bool is_child_left);
-        void RecursiveDraw(const std::unique_ptr<DrawableNode>& node);
-
+        void DrawTree();
+        void DrawVisible();
+        void ScheduleRedraw();
+        void DrawNode(size_t node);
+        void DrawGlyph(size_t node);
+        void DrawEdgeBetweenNodes(size_t parent, bool is_child_left);
+        void RemoveStaleItems();
+        [[nodiscard]] float X(size_t node) const;
+        [[nodiscard]] size_t BlackHeight(size_t node) const;
 
         static constexpr float default_node_diameter = 50;
         static constexpr float horizontal_space_between_nodes = 5;
         static constexpr float vertical_space_between_nodes = 3;
         static constexpr int draw_delay_in_ms = 500;
+        static constexpr qreal size_text_scale = 0.6;
+        // Level of detail, in pixels on the screen. The subtrees narrower than
+        // min_glyph_width_in_pixels are drawn as one glyph once the nodes are smaller than
+        // min_node_size_in_pixels, the texts are drawn only when they can be read.
+        static constexpr qreal min_node_size_in_pixels = 8;
+        static constexpr qreal min_glyph_width_in_pixels = 64;
+        static constexpr qreal min_glyph_label_width_in_pixels = 40;
+        static constexpr qreal min_label_size_in_pixels = 20;
+        static constexpr qreal zoom_step = 1.25;
         float tree_width_ = 0;
         float current_node_diameter_ = default_node_diameter;
+        // The columns are squeezed by x_scale_ to fit the tree into the window
+        float x_scale_ = 1;
+        bool labels_visible_ = true;
+        bool redraw_pending_ = false;
         TreeQuery query_;
         MainWindow main_window_;
-        Observer<RedBlackTree<int>::Data> observer_model_view_;
+        // The frame on the scene, shared with the layout worker which built it
+        std::shared_ptr<const DrawableTree> drawable_tree_ = std::make_shared<DrawableTree>();
+        // Reused by DrawVisible and LayOutFrame
+        std::vector<size_t> index_stack_;
+        std::vector<TreeMirror<int>::NodeId> layout_stack_;
+        QTimer frame_timer_;
+        // The items on the scene by the node they show. A frame only touches the items which
+        // changed, and adds or removes the items of inserted or erased nodes.
+        std::unordered_map<TreeMirror<int>::NodeId, NodeItems> scene_items_;
+        size_t frame_ = 0;
         Observable<TreeQuery> observable_view_controller_;
+        // The last member, its thread stops before the rest of the view goes away
+        std::unique_ptr<LayoutWorker<int, DrawableTree>> layout_worker_;
     };
 }// namespace DSVisualization